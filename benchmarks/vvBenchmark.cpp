@@ -0,0 +1,394 @@
+// Headless benchmark for the vtkVRUI framework overhead.
+//
+// Drives a vvApplicationState through init/syncApplicationState/
+// syncContextState without a VR display, using synthetic vvLODAsyncGLObjects
+// whose pipelines sleep (or burn CPU) for configurable durations. For each
+// object count, reports the per-frame overhead while the objects converge to
+// HiRes and when idle, and the time until each object shows its HiRes LOD.
+//
+// Heap allocations made during idle frames are counted as well. Once all
+// background work has finished and vvProgress is empty, frames without state
+// changes must not allocate; with --check-allocations, the benchmark fails if
+// any do. CTest runs a short configuration of this check, see CMakeLists.txt.
+//
+// Usage: vvBenchmark [--hint-ms N] [--lores-ms N] [--hires-ms N] [--burn]
+//                    [--frame-ms N] [--idle-frames N] [--max-objects N]
+//                    [--timeout-s N] [--check-allocations]
+
+#include <GL/GLContextData.h>
+
+#include "vvApplicationState.h"
+#include "vvContextState.h"
+#include "vvLODAsyncGLObject.h"
+#include "vvProgress.h"
+#include "vvStatistics.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Count every heap allocation in the process:
+std::atomic<std::size_t> allocationCount(0);
+
+void* operator new(std::size_t size)
+{
+  ++allocationCount;
+  if (void *ptr = std::malloc(size > 0 ? size : 1))
+    {
+    return ptr;
+    }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+  double lodSeconds[3] = { 0.5, 0.05, 0.005 }; // HiRes, LoRes, Hint
+  bool burn = false;
+  double frameSeconds = 1. / 90.;
+  int idleFrames = 200;
+  int maxObjects = 1000;
+  double timeoutSeconds = 600.;
+  bool checkAllocations = false;
+};
+
+bool allocationCheckFailed = false;
+
+Options options;
+
+// Sleep or spin for the requested duration:
+void work(double seconds)
+{
+  const Clock::time_point end = Clock::now() +
+      std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+  if (!options.burn)
+    {
+    std::this_thread::sleep_until(end);
+    return;
+    }
+
+  volatile double sink = 0.;
+  while (Clock::now() < end)
+    {
+    for (int i = 0; i < 1000; ++i)
+      {
+      sink = sink + i * 0.5;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+class SyntheticObject : public vvLODAsyncGLObject
+{
+public:
+  struct State : public ObjectState
+  {
+    void update(const vvApplicationState &) override {}
+    int version{1};
+  };
+
+  struct Data : public LODData
+  {
+    int version{0};
+  };
+
+  struct Pipeline : public DataPipeline
+  {
+    explicit Pipeline(double seconds) : m_seconds(seconds) {}
+
+    void configure(const ObjectState &objState,
+                   const vvApplicationState &) override
+    {
+      m_version = static_cast<const State&>(objState).version;
+    }
+
+    bool needsUpdate(const ObjectState &objState,
+                     const LODData &result) const override
+    {
+      return static_cast<const State&>(objState).version !=
+          static_cast<const Data&>(result).version;
+    }
+
+    void execute(const vvCancellationToken &) override
+    {
+      work(m_seconds);
+      m_output = m_version;
+    }
+
+    void exportResult(LODData &result) const override
+    {
+      static_cast<Data&>(result).version = m_output;
+    }
+
+    double m_seconds;
+    int m_version{0};
+    int m_output{0};
+  };
+
+  struct Renderer : public RenderPipeline
+  {
+    Renderer(const SyntheticObject *object, bool best)
+      : m_object(object), m_best(best) {}
+
+    void init(const ObjectState &, vvContextState &) override {}
+
+    void update(const ObjectState &, const vvApplicationState &,
+                const vvContextState &, const LODData &) override
+    {
+      if (m_best && m_object->m_hiResTime == Clock::time_point())
+        {
+        m_object->m_hiResTime = Clock::now();
+        }
+    }
+
+    void disable() override {}
+
+    const SyntheticObject *m_object;
+    bool m_best;
+  };
+
+  // Set by the HiRes render pipeline the first time it is shown:
+  mutable Clock::time_point m_hiResTime;
+
+private:
+  std::string progressLabel() const override { return "Synthetic"; }
+
+  ObjectState* createObjectState() const override { return new State; }
+
+  DataPipeline* createDataPipeline(LevelOfDetail lod) const override
+  {
+    return new Pipeline(options.lodSeconds[static_cast<size_t>(lod)]);
+  }
+
+  RenderPipeline* createRenderPipeline(LevelOfDetail lod) const override
+  {
+    return new Renderer(this, lod == LevelOfDetail::HiRes);
+  }
+
+  LODData* createLODData(LevelOfDetail) const override { return new Data; }
+};
+
+//------------------------------------------------------------------------------
+void printSummary(const char *label, const vvStatistics::Summary &s)
+{
+  std::cout << "  " << std::left << std::setw(22) << label << std::right
+            << std::fixed << std::setprecision(3)
+            << " mean " << std::setw(9) << s.mean * 1e3 << " ms"
+            << "  p95 " << std::setw(9) << s.p95 * 1e3 << " ms"
+            << "  p99 " << std::setw(9) << s.p99 * 1e3 << " ms"
+            << "  max " << std::setw(9) << s.max * 1e3 << " ms"
+            << "  (n=" << s.count << ")\n";
+}
+
+//------------------------------------------------------------------------------
+// Returns the number of heap allocations made by the frame:
+std::size_t runFrame(vvApplicationState &state, vvContextState &contextState,
+                     GLContextData &contextData, vvStatistics &stats,
+                     const std::string &series)
+{
+  const Clock::time_point frameStart = Clock::now();
+  const std::size_t allocationsBefore = allocationCount;
+
+  state.syncApplicationState();
+  state.syncContextState(contextState, contextData);
+
+  const std::size_t allocations = allocationCount - allocationsBefore;
+  stats.record(series, vvStatistics::elapsed(frameStart));
+
+  // Stand-in for the VRUI event loop, which runs at the display rate:
+  std::this_thread::sleep_until(
+        frameStart + std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(options.frameSeconds)));
+
+  return allocations;
+}
+
+//------------------------------------------------------------------------------
+void run(int numObjects)
+{
+  vvStatistics stats;
+  std::atomic<std::size_t> updateRequests(0);
+
+  vvApplicationState state;
+  state.setUpdateRequestHandler([&updateRequests]() { ++updateRequests; });
+
+  // Declared after state, so the objects are destroyed first:
+  std::vector<std::unique_ptr<SyntheticObject> > objects;
+  for (int i = 0; i < numObjects; ++i)
+    {
+    objects.emplace_back(new SyntheticObject);
+    state.objects().push_back(objects.back().get());
+    }
+
+  state.init();
+
+  GLContextData contextData(101);
+  vvContextState contextState;
+  state.initContext(contextState, contextData);
+
+  // Converge to HiRes:
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point timeout = start +
+      std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.timeoutSeconds));
+  std::size_t remaining = objects.size();
+  while (remaining > 0 && Clock::now() < timeout)
+    {
+    runFrame(state, contextState, contextData, stats, "converging");
+
+    remaining = 0;
+    for (const auto &object : objects)
+      {
+      if (object->m_hiResTime == Clock::time_point())
+        {
+        ++remaining;
+        }
+      }
+    }
+
+  for (const auto &object : objects)
+    {
+    if (object->m_hiResTime != Clock::time_point())
+      {
+      stats.record("timeToHiRes",
+                   std::chrono::duration<double>(
+                     object->m_hiResTime - start).count());
+      }
+    }
+
+  // Settle: collect any remaining background updates (e.g. LODs that were
+  // still running when HiRes appeared) until no progress entry is left:
+  while (state.progress().numberOfEntries() > 0 && Clock::now() < timeout)
+    {
+    runFrame(state, contextState, contextData, stats, "settling");
+    }
+
+  // Steady state. Every idle frame counts:
+  std::size_t idleAllocations = 0;
+  for (int i = 0; i < options.idleFrames; ++i)
+    {
+    idleAllocations +=
+        runFrame(state, contextState, contextData, stats, "idle");
+    }
+
+  std::cout << numObjects << " object(s), " << state.workerThreadCount()
+            << " worker thread(s), " << updateRequests
+            << " update request(s)";
+  if (remaining > 0)
+    {
+    std::cout << ", " << remaining << " TIMED OUT";
+    }
+  std::cout << "\n";
+  printSummary("frame (converging)", stats.summary("converging"));
+  printSummary("frame (idle)", stats.summary("idle"));
+  printSummary("time to HiRes", stats.summary("timeToHiRes"));
+  std::cout << "  heap allocations in idle frames: " << idleAllocations << "\n";
+
+  if (options.checkAllocations && idleAllocations > 0)
+    {
+    std::cout << "  FAILED: idle frames must not allocate.\n";
+    allocationCheckFailed = true;
+    }
+
+  // Remove the synthetic objects before they are destroyed:
+  state.objects().resize(state.objects().size() - objects.size());
+}
+
+//------------------------------------------------------------------------------
+bool parseArguments(int argc, char *argv[])
+{
+  for (int i = 1; i < argc; ++i)
+    {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+    if (std::strcmp(arg, "--burn") == 0)
+      {
+      options.burn = true;
+      continue;
+      }
+    if (std::strcmp(arg, "--check-allocations") == 0)
+      {
+      options.checkAllocations = true;
+      continue;
+      }
+    if (value == nullptr)
+      {
+      return false;
+      }
+    ++i;
+
+    if (std::strcmp(arg, "--hires-ms") == 0)
+      {
+      options.lodSeconds[0] = std::atof(value) * 1e-3;
+      }
+    else if (std::strcmp(arg, "--lores-ms") == 0)
+      {
+      options.lodSeconds[1] = std::atof(value) * 1e-3;
+      }
+    else if (std::strcmp(arg, "--hint-ms") == 0)
+      {
+      options.lodSeconds[2] = std::atof(value) * 1e-3;
+      }
+    else if (std::strcmp(arg, "--frame-ms") == 0)
+      {
+      options.frameSeconds = std::atof(value) * 1e-3;
+      }
+    else if (std::strcmp(arg, "--idle-frames") == 0)
+      {
+      options.idleFrames = std::atoi(value);
+      }
+    else if (std::strcmp(arg, "--max-objects") == 0)
+      {
+      options.maxObjects = std::atoi(value);
+      }
+    else if (std::strcmp(arg, "--timeout-s") == 0)
+      {
+      options.timeoutSeconds = std::atof(value);
+      }
+    else
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  if (!parseArguments(argc, argv))
+    {
+    std::cerr << "Usage: " << argv[0]
+              << " [--hint-ms N] [--lores-ms N] [--hires-ms N] [--burn]\n"
+                 "       [--frame-ms N] [--idle-frames N] [--max-objects N]\n"
+                 "       [--timeout-s N] [--check-allocations]\n";
+    return EXIT_FAILURE;
+    }
+
+  for (int numObjects = 1; numObjects <= options.maxObjects; numObjects *= 10)
+    {
+    run(numObjects);
+    }
+
+  return allocationCheckFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
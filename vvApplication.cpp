@@ -6,6 +6,7 @@
 #include "vvApplicationState.h"
 #include "vvContextState.h"
 #include "vvFramerate.h"
+#include "vvTracer.h"
 
 #include <Vrui/WindowProperties.h>
 
@@ -68,6 +69,8 @@ void vvApplication::display(GLContextData &contextData) const
 {
   vvContextState *context = contextData.retrieveDataItem<vvContextState>(this);
 
+  vvTracer::Span span("display", "render");
+
   // Synchronize vvGLObjects:
   m_state->syncContextState(*context, contextData);
 
@@ -78,6 +81,8 @@ void vvApplication::display(GLContextData &contextData) const
 //------------------------------------------------------------------------------
 void vvApplication::frame()
 {
+  vvTracer::Span span("frame", "frame");
+
   // Synchronize vvGLObjects:
   m_state->syncApplicationState();
 }
@@ -1,12 +1,37 @@
 #include "vvApplicationState.h"
 
+#include <Vrui/Vrui.h>
+
+#include "vvCompletionQueue.h"
+#include "vvDiskCache.h"
 #include "vvFramerate.h"
+#include "vvMemoryManager.h"
 #include "vvProgress.h"
+#include "vvStatistics.h"
+#include "vvGLObject.h"
+#include "vvThreadPool.h"
+#include "vvTracer.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <typeinfo>
 
 //------------------------------------------------------------------------------
 vvApplicationState::vvApplicationState()
   : m_framerate(new vvFramerate),
-    m_progress(new vvProgress)
+    m_progress(new vvProgress),
+    m_threadPool(new vvThreadPool),
+    m_completionQueue(new vvCompletionQueue),
+    m_memoryManager(new vvMemoryManager),
+    m_diskCache(new vvDiskCache),
+    m_statistics(new vvStatistics),
+    m_requestUpdate(&Vrui::requestUpdate),
+    m_frameBudget(0.),
+    m_lastSyncTime(0.),
+    m_deferredObjectCount(0),
+    m_budgetOverruns(0),
+    m_nextObject(0)
 {
   m_objects.push_back(m_framerate);
   m_objects.push_back(m_progress);
@@ -15,8 +40,28 @@ vvApplicationState::vvApplicationState()
 //------------------------------------------------------------------------------
 vvApplicationState::~vvApplicationState()
 {
+  this->setTraceFile(std::string());
+
+  if (!m_statisticsFile.empty())
+    {
+    std::ofstream out(m_statisticsFile.c_str());
+    if (out)
+      {
+      m_statistics->dump(out);
+      }
+    else
+      {
+      std::cerr << "Cannot write statistics to " << m_statisticsFile << "\n";
+      }
+    }
+
   delete m_framerate;
   delete m_progress;
+  delete m_threadPool;
+  delete m_completionQueue;
+  delete m_memoryManager;
+  delete m_diskCache;
+  delete m_statistics;
 }
 
 //------------------------------------------------------------------------------
@@ -41,10 +86,119 @@ void vvApplicationState::initContext(vvContextState &state,
 //------------------------------------------------------------------------------
 void vvApplicationState::syncApplicationState()
 {
-  for (auto object : m_objects)
+  using Clock = std::chrono::steady_clock;
+
+  vvTracer::Span span("syncApplicationState", "frame");
+
+  const Clock::time_point start = Clock::now();
+  const bool budgeted = m_frameBudget > 0.;
+  const Clock::time_point deadline = budgeted
+      ? start + std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(m_frameBudget))
+      : Clock::time_point::max();
+
+  // Hand finished background jobs back to their owners:
+  m_completionQueue->drain(*this, deadline);
+
+  // Sync objects in round-robin order. Once the deadline has passed, only
+  // objects that cannot be deferred are synced, and the next frame starts at
+  // the first deferred object. At least one deferrable object is synced each
+  // frame to guarantee progress.
+  const size_t numObjects = m_objects.size();
+  if (m_nextObject >= numObjects)
     {
+    m_nextObject = 0;
+    }
+
+  size_t nextObject = m_nextObject;
+  bool syncedDeferrable = false;
+  m_deferredObjectCount = 0;
+  for (size_t i = 0; i < numObjects; ++i)
+    {
+    const size_t index = (m_nextObject + i) % numObjects;
+    vvGLObject *object = m_objects[index];
+
+    if (object->deferrable())
+      {
+      if (m_deferredObjectCount == 0 &&
+          (!budgeted || !syncedDeferrable || Clock::now() < deadline))
+        {
+        syncedDeferrable = true;
+        }
+      else
+        {
+        if (m_deferredObjectCount++ == 0)
+          { // Out of time -- resume with this object next frame:
+          nextObject = index;
+          }
+        continue;
+        }
+      }
+
+    vvTracer::Span objectSpan("vvGLObject::syncApplicationState", "frame",
+                              typeid(*object).name());
     object->syncApplicationState(*this);
     }
+  m_nextObject = nextObject;
+
+  // Release inactive results if the objects went over the memory budget:
+  m_memoryManager->enforce();
+
+  m_lastSyncTime = std::chrono::duration<double>(Clock::now() - start).count();
+  if (budgeted && m_lastSyncTime > m_frameBudget)
+    {
+    ++m_budgetOverruns;
+    }
+
+  // Make sure the deferred objects get another frame:
+  if (m_deferredObjectCount > 0)
+    {
+    this->requestUpdate();
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvApplicationState::requestUpdate() const
+{
+  if (m_requestUpdate)
+    {
+    m_requestUpdate();
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvApplicationState::setUpdateRequestHandler(UpdateRequestHandler handler)
+{
+  m_completionQueue->setUpdateRequestHandler(handler);
+  m_requestUpdate = std::move(handler);
+}
+
+//------------------------------------------------------------------------------
+void vvApplicationState::setTraceFile(const std::string &file)
+{
+  vvTracer &tracer = vvTracer::instance();
+  if (!m_traceFile.empty() && !tracer.stop())
+    {
+    std::cerr << "Cannot write trace to " << m_traceFile << "\n";
+    }
+
+  m_traceFile = file;
+  if (!m_traceFile.empty())
+    {
+    tracer.start(m_traceFile);
+    }
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvApplicationState::workerThreadCount() const
+{
+  return m_threadPool->size();
+}
+
+//------------------------------------------------------------------------------
+void vvApplicationState::setWorkerThreadCount(std::size_t count)
+{
+  m_threadPool->resize(count);
 }
 
 //------------------------------------------------------------------------------
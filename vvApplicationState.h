@@ -3,11 +3,17 @@
 
 class GLContextData;
 
+class vvCompletionQueue;
 class vvContextState;
+class vvDiskCache;
 class vvFramerate;
 class vvGLObject;
+class vvMemoryManager;
 class vvProgress;
+class vvStatistics;
+class vvThreadPool;
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -22,6 +28,7 @@ class vvApplicationState
 {
 public:
   using Objects = std::vector<vvGLObject*>;
+  using UpdateRequestHandler = std::function<void()>;
 
   vvApplicationState();
   virtual ~vvApplicationState();
@@ -39,8 +46,14 @@ public:
   virtual void initContext(vvContextState &state, GLContextData &data) const;
 
   /**
-   * Per-frame sync of application state. Calls vvGLObject::syncApplicationState
-   * on all objects in objects().
+   * Per-frame sync of application state. Drains completionQueue(), then calls
+   * vvGLObject::syncApplicationState on all objects in objects(), and finally
+   * enforces the memoryManager() budget.
+   *
+   * If frameBudget() is set, finished jobs and deferrable objects (see
+   * vvGLObject::deferrable()) that do not fit into the budget are postponed to
+   * the next frame. Objects are visited in round-robin order, starting with the
+   * first one that was postponed, so every object is eventually synced.
    */
   virtual void syncApplicationState();
 
@@ -51,6 +64,48 @@ public:
   virtual void syncContextState(const vvContextState &contextState,
                                 GLContextData &contextData) const;
 
+  /**
+   * Ask the event loop for another frame. Calls the handler set by
+   * setUpdateRequestHandler(), Vrui::requestUpdate() by default.
+   */
+  void requestUpdate() const;
+
+  /**
+   * Replace Vrui::requestUpdate() for this state and its completionQueue(),
+   * e.g. to drive the application state without VRUI. Must be called before
+   * any background work is started.
+   */
+  void setUpdateRequestHandler(UpdateRequestHandler handler);
+
+  /**
+   * If set, a Chrome trace of frames, object syncs, pipeline executions and
+   * renders is recorded and written to this file when the application state is
+   * destroyed (or the file is changed). Empty (default) disables tracing. See
+   * vvTracer.
+   * @{
+   */
+  const std::string& traceFile() const { return m_traceFile; }
+  void setTraceFile(const std::string &file);
+  /** @} */
+
+  /**
+   * Time budget for syncApplicationState() in seconds. Zero (default) disables
+   * the budget. For example, 0.005 leaves most of a 90 Hz frame for rendering.
+   * @{
+   */
+  double frameBudget() const { return m_frameBudget; }
+  void setFrameBudget(double seconds) { m_frameBudget = seconds; }
+  /** @} */
+
+  /** Time spent in the last syncApplicationState() call, in seconds. */
+  double lastSyncTime() const { return m_lastSyncTime; }
+
+  /** Number of objects postponed by the last syncApplicationState() call. */
+  std::size_t deferredObjectCount() const { return m_deferredObjectCount; }
+
+  /** Number of syncApplicationState() calls that exceeded frameBudget(). */
+  std::size_t budgetOverruns() const { return m_budgetOverruns; }
+
   /** List of all vvGLObjects. */
   Objects& objects() { return m_objects; }
   const Objects& objects() const { return m_objects; }
@@ -64,6 +119,55 @@ public:
    * vvAsyncGLObject::syncApplicationState(const vvAppState&). */
   vvProgress& progress() const { return *m_progress; }
 
+  /**
+   * Worker pool used for all background pipeline executions. Not const-correct
+   * for the same reasons as progress().
+   */
+  vvThreadPool& threadPool() const { return *m_threadPool; }
+
+  /**
+   * Queue of finished background jobs, drained at the start of each
+   * syncApplicationState(). Not const-correct for the same reasons as
+   * progress().
+   */
+  vvCompletionQueue& completionQueue() const { return *m_completionQueue; }
+
+  /**
+   * Process-wide memory budget for pipeline results. Not const-correct for the
+   * same reasons as progress().
+   */
+  vvMemoryManager& memoryManager() const { return *m_memoryManager; }
+
+  /**
+   * Persistent cache of reduced data, disabled until a directory is set. Not
+   * const-correct for the same reasons as progress().
+   */
+  vvDiskCache& diskCache() const { return *m_diskCache; }
+
+  /**
+   * Timing statistics recorded by vvLODAsyncGLObjects and vvReaders. Not
+   * const-correct for the same reasons as progress().
+   */
+  vvStatistics& statistics() const { return *m_statistics; }
+
+  /**
+   * If set, statistics() are written to this file when the application state
+   * is destroyed. Empty (default) disables the dump.
+   * @{
+   */
+  const std::string& statisticsFile() const { return m_statisticsFile; }
+  void setStatisticsFile(const std::string &file) { m_statisticsFile = file; }
+  /** @} */
+
+  /**
+   * The number of worker threads in threadPool(). Defaults to the number of
+   * hardware threads. Setting 0 restores the default.
+   * @{
+   */
+  std::size_t workerThreadCount() const;
+  void setWorkerThreadCount(std::size_t count);
+  /** @} */
+
 protected:
   Objects m_objects;
 
@@ -74,6 +178,21 @@ private:
 
   vvFramerate *m_framerate;
   vvProgress *m_progress;
+  vvThreadPool *m_threadPool;
+  vvCompletionQueue *m_completionQueue;
+  vvMemoryManager *m_memoryManager;
+  vvDiskCache *m_diskCache;
+  vvStatistics *m_statistics;
+  std::string m_statisticsFile;
+  std::string m_traceFile;
+  UpdateRequestHandler m_requestUpdate;
+
+  // Frame budget:
+  double m_frameBudget;
+  double m_lastSyncTime;
+  std::size_t m_deferredObjectCount;
+  std::size_t m_budgetOverruns;
+  std::size_t m_nextObject; // Round-robin start
 };
 
 #endif // VVAPPLICATIONSTATE_H
@@ -1,10 +1,10 @@
 #include "vvAsyncGLObject.h"
 
-#include <Vrui/Vrui.h>
-
 #include "vvApplicationState.h"
+#include "vvCompletionQueue.h"
 #include "vvProgress.h"
 #include "vvProgressCookie.h"
+#include "vvThreadPool.h"
 
 #include <cassert>
 #include <chrono>
@@ -12,21 +12,38 @@
 
 //------------------------------------------------------------------------------
 vvAsyncGLObject::vvAsyncGLObject()
-  : m_cookie(nullptr)
+  : m_completionQueue(nullptr),
+    m_cookie(nullptr),
+    m_latestWins(false),
+    m_supersededCount(0),
+    m_executeSeconds(0.),
+    m_executeInputSize(1.)
 {
 }
 
 //------------------------------------------------------------------------------
 vvAsyncGLObject::~vvAsyncGLObject()
 {
+  // Pool futures do not block on destruction, so stop the background
+  // calculation and wait for it explicitly:
+  if (m_monitor.valid())
+    {
+    m_token.cancel();
+    m_monitor.wait();
+    }
+
+  if (m_completionQueue)
+    {
+    m_completionQueue->discard(this);
+    }
+
   // Don't free cookie -- vvProgress owns these and will clean them up.
   // If vvAsyncGLObjects start being deleted before process exit, we'll have
   // to remove cookies from vvProgress from the cookie's dtor.
 
-  // TODO add an abortDataPipeline virtual to stop calculations on exit.
-  // This wouldn't go here (the subclass would already be destroyed), but
-  // should go in some vvGLObject::aboutToExit virtual called by
-  // vvApplicationState's dtor.
+  // TODO The cancellation above arrives after the subclass has already been
+  // destroyed. It should be moved to some vvGLObject::aboutToExit virtual
+  // called by vvApplicationState's dtor.
 }
 
 //------------------------------------------------------------------------------
@@ -36,46 +53,38 @@ void vvAsyncGLObject::syncApplicationState(const vvApplicationState &appState)
 
   this->frame(appState);
 
-  // Check if an asynch update is in process:
+  // Check if an asynch update is in process. Finished updates are collected
+  // by completeUpdate() before this is called, which resets m_monitor.
   if (m_monitor.valid())
     {
-    // If so, see if the operation has completed:
-    std::future_status state = m_monitor.wait_for(std::chrono::milliseconds(0));
-
-    // We should not be using deferred execution:
-    assert("Always async." && state != std::future_status::deferred);
-
-    if (state == std::future_status::ready)
+    // Abandon the update if newer parameters are waiting:
+    if (m_latestWins && !m_token.cancelled() &&
+        this->dataPipelineIsObsolete(appState))
       {
-      // Clear the monitor:
-      m_monitor.get();
-
-      // Sync application state cache:
-      this->retrieveDataPipelineResult();
-
-      // Clean up the progress monitor:
-      assert("Cookie exists." && m_cookie != nullptr);
-      appState.progress().removeEntry(m_cookie);
-      m_cookie = nullptr;
-      }
-    else
-      {
-      // Data pipeline has not completed yet.
-      return;
+      m_token.cancel();
       }
+
+    // Data pipeline has not completed yet.
+    return;
     }
 
-  // We only reach this point if there's no update in progress, or if we've just
-  // retrieved the last result, so check if we need to update.
+  // We only reach this point if there's no update in progress, so check if we
+  // need to update.
   this->configureDataPipeline(appState);
   if (this->dataPipelineNeedsUpdate())
     {
     assert("Cookie cleaned up." && m_cookie == nullptr);
     m_cookie = appState.progress().addEntry(this->progressLabel());
+    m_executeInputSize = this->dataPipelineInputSize();
+    m_cookie->setEstimatedDuration(
+          m_executionEstimate.estimate(m_executeInputSize));
 
     // Launch background calculation.
-    m_monitor = std::async(std::launch::async,
-                           &vvAsyncGLObject::internalExecutePipeline, this);
+    m_completionQueue = &appState.completionQueue();
+    m_token = vvCancellationToken();
+    m_monitor = appState.threadPool().submit(
+          vvThreadPool::Priority(), &vvAsyncGLObject::internalExecutePipeline,
+          this, m_token);
     }
 }
 
@@ -85,8 +94,66 @@ void vvAsyncGLObject::frame(const vvApplicationState &)
 }
 
 //------------------------------------------------------------------------------
-void vvAsyncGLObject::internalExecutePipeline() const
+double vvAsyncGLObject::dataPipelineInputSize() const
+{
+  return 1.;
+}
+
+//------------------------------------------------------------------------------
+bool vvAsyncGLObject::dataPipelineIsObsolete(const vvApplicationState &) const
 {
-  this->executeDataPipeline();
-  Vrui::requestUpdate();
+  return false;
+}
+
+//------------------------------------------------------------------------------
+void vvAsyncGLObject::internalExecutePipeline(vvCancellationToken token)
+{
+  // The handler must be queued even if the pipeline throws, so that the
+  // exception is rethrown from m_monitor.get() on the GUI thread:
+  auto handler = [this](const vvApplicationState &state)
+    {
+    this->completeUpdate(state);
+    };
+
+  m_cookie->start();
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  try
+    {
+    this->executeDataPipeline(token);
+    }
+  catch (...)
+    {
+    m_completionQueue->push(this, handler);
+    throw;
+    }
+  m_executeSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+  m_completionQueue->push(this, handler);
+}
+
+//------------------------------------------------------------------------------
+void vvAsyncGLObject::completeUpdate(const vvApplicationState &appState)
+{
+  // Clean up the progress monitor first, get() rethrows errors from the
+  // background thread:
+  assert("Cookie exists." && m_cookie != nullptr);
+  appState.progress().removeEntry(m_cookie);
+  m_cookie = nullptr;
+
+  // The handler is queued just before the task returns, so this may block very
+  // briefly:
+  m_monitor.get();
+
+  if (m_token.cancelled())
+    { // Superseded -- drop the stale result, it is relaunched in the next sync.
+    ++m_supersededCount;
+    }
+  else
+    { // Sync application state cache:
+    this->retrieveDataPipelineResult();
+
+    m_executionEstimate.record(m_executeSeconds, m_executeInputSize);
+    }
 }
@@ -1,10 +1,13 @@
 #ifndef VVASYNCGLOBJECT_H
 #define VVASYNCGLOBJECT_H
 
+#include "vvCancellationToken.h"
 #include "vvGLObject.h"
+#include "vvStatistics.h"
 
 #include <future>
 
+class vvCompletionQueue;
 class vvProgressCookie;
 
 /**
@@ -20,7 +23,7 @@ class vvProgressCookie;
  *
  * - void vvAsyncGLObject::configureDataPipeline(const vvApplicationState &)
  * - bool vvAsyncGLObject::dataPipelineNeedsUpdate() const
- * - void vvAsyncGLObject::executeDataPipeline() const
+ * - void vvAsyncGLObject::executeDataPipeline(const vvCancellationToken&) const
  * - void vvAsyncGLObject::retrieveDataPipelineResult()
  *
  * For proper usage, the data pipeline objects must only be modified from within
@@ -48,6 +51,33 @@ public:
    */
   void syncApplicationState(const vvApplicationState &appState) final;
 
+  /**
+   * If true, an in-flight update is cancelled as soon as
+   * dataPipelineIsObsolete() reports that its parameters are stale, and the
+   * data pipeline is reconfigured and relaunched as soon as the cancelled run
+   * returns. Intermediate results are never retrieved. Default is false, in
+   * which case every started update is completed and retrieved before the
+   * next one starts.
+   * @{
+   */
+  bool latestWins() const { return m_latestWins; }
+  void setLatestWins(bool latestWins) { m_latestWins = latestWins; }
+  /** @} */
+
+  /**
+   * The number of updates that were cancelled and discarded in latest-wins
+   * mode.
+   */
+  std::size_t supersededCount() const { return m_supersededCount; }
+
+protected:
+  /**
+   * The vvProgress entry of the update in progress, or nullptr. May be used
+   * from executeDataPipeline() to report progress, see
+   * vvProgressCookie::Observer.
+   */
+  vvProgressCookie* progressCookie() const { return m_cookie; }
+
 private: // Virtual API:
 
   /**
@@ -71,12 +101,34 @@ private: // Virtual API:
    */
   virtual bool dataPipelineNeedsUpdate() const = 0;
 
+  /**
+   * Size of the input processed by the configuration applied in the last
+   * call to configureDataPipeline(), in arbitrary but consistent units (e.g.
+   * number of cells). Progress estimates are scaled by it. Called from the GUI
+   * thread before an update is launched. The default implementation returns
+   * 1.
+   */
+  virtual double dataPipelineInputSize() const;
+
+  /**
+   * Return true if the update currently executing was configured with
+   * parameters that no longer match the object's state. Only used in
+   * latest-wins mode. This is called while executeDataPipeline() is running,
+   * so it must not touch the data pipeline; compare the ivars updated in
+   * frame() with the values last applied in configureDataPipeline() instead.
+   * The default implementation returns false.
+   */
+  virtual bool dataPipelineIsObsolete(const vvApplicationState &state) const;
+
   /**
    * Execute the data pipeline. This is called in a background thread. A typical
    * implementation simply calls 'Update()' on the data pipeline's sink
-   * vtkAlgorithms.
+   * vtkAlgorithms. If @a token is cancelled (e.g. during destruction), the
+   * execution should stop as soon as possible. See
+   * vvCancellationToken::AbortObserver. Progress can be reported through
+   * progressCookie().
    */
-  virtual void executeDataPipeline() const = 0;
+  virtual void executeDataPipeline(const vvCancellationToken &token) const = 0;
 
   /**
    * Retrieve the output data objects from the data pipeline. A typical
@@ -110,13 +162,30 @@ private: // Virtual API:
 
 private:
   /**
-   * Wrapper around the data pipeline update call. Ensures that a new frame is
-   * requested when the pipeline updates.
+   * Wrapper around the data pipeline update call. Queues completeUpdate() on
+   * vvApplicationState::completionQueue() when the pipeline finishes.
+   */
+  void internalExecutePipeline(vvCancellationToken token);
+
+  /**
+   * Collects a finished update. Called from the GUI thread by
+   * vvCompletionQueue::drain().
    */
-  void internalExecutePipeline() const;
+  void completeUpdate(const vvApplicationState &appState);
 
+  vvCompletionQueue *m_completionQueue;
   std::future<void> m_monitor;
+  vvCancellationToken m_token;
   vvProgressCookie *m_cookie;
+  bool m_latestWins;
+  std::size_t m_supersededCount;
+
+  // Execution time (written by the task) and input size of the last update,
+  // and their moving average over completed updates. Used for progress
+  // estimates:
+  double m_executeSeconds;
+  double m_executeInputSize;
+  vvStatistics::Estimator m_executionEstimate;
 };
 
 #endif // VVASYNCGLOBJECT_H
@@ -0,0 +1,60 @@
+#include "vvCancellationToken.h"
+
+#include <vtkAlgorithm.h>
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+
+namespace {
+void abortIfCancelled(vtkObject *caller, unsigned long, void *clientData,
+                      void *)
+{
+  const vvCancellationToken *token =
+      static_cast<const vvCancellationToken*>(clientData);
+  if (token->cancelled())
+    {
+    static_cast<vtkAlgorithm*>(caller)->SetAbortExecute(1);
+    }
+}
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+vvCancellationToken::vvCancellationToken()
+  : m_cancelled(std::make_shared<std::atomic<bool> >(false))
+{
+}
+
+//------------------------------------------------------------------------------
+void vvCancellationToken::cancel() const
+{
+  m_cancelled->store(true);
+}
+
+//------------------------------------------------------------------------------
+bool vvCancellationToken::cancelled() const
+{
+  return m_cancelled->load();
+}
+
+//------------------------------------------------------------------------------
+vvCancellationToken::AbortObserver::AbortObserver(
+    const vvCancellationToken &token, vtkAlgorithm *algorithm)
+  : m_token(token),
+    m_algorithm(algorithm),
+    m_command(vtkSmartPointer<vtkCallbackCommand>::New()),
+    m_observerId(0)
+{
+  m_command->SetCallback(&abortIfCancelled);
+  m_command->SetClientData(&m_token);
+  m_observerId = m_algorithm->AddObserver(vtkCommand::ProgressEvent,
+                                          m_command.Get());
+}
+
+//------------------------------------------------------------------------------
+vvCancellationToken::AbortObserver::~AbortObserver()
+{
+  m_algorithm->RemoveObserver(m_observerId);
+  if (m_token.cancelled())
+    {
+    m_algorithm->Modified();
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef VVCANCELLATIONTOKEN_H
+#define VVCANCELLATIONTOKEN_H
+
+#include <vtkSmartPointer.h>
+
+#include <atomic>
+#include <memory>
+
+class vtkAlgorithm;
+class vtkCallbackCommand;
+
+/**
+ * @brief The vvCancellationToken class notifies a background execution that
+ * its result is no longer needed.
+ *
+ * A token is handed to each asynchronous execution (e.g.
+ * vvLODAsyncGLObject::DataPipeline::execute). The GUI thread calls cancel()
+ * when the result becomes obsolete, and the executing code should poll
+ * cancelled() between expensive steps and return early. Copies of a token
+ * share the same state.
+ *
+ * VTK algorithms can be tied to a token with an AbortObserver:
+ *
+ * @code
+ * void MyPipeline::execute(const vvCancellationToken &token)
+ * {
+ *   vvCancellationToken::AbortObserver abort(token, m_contour.Get());
+ *   m_contour->Update();
+ * }
+ * @endcode
+ */
+class vvCancellationToken
+{
+public:
+  class AbortObserver;
+
+  /** Create a new token that is not cancelled. */
+  vvCancellationToken();
+
+  /** Request cancellation. Thread-safe. */
+  void cancel() const;
+
+  /** Returns true if cancel() has been called. Thread-safe. */
+  bool cancelled() const;
+
+private:
+  std::shared_ptr<std::atomic<bool> > m_cancelled;
+};
+
+/**
+ * @brief Sets vtkAlgorithm::AbortExecute on an algorithm while it is executing
+ * for a cancelled token.
+ *
+ * The flag is checked whenever the algorithm reports progress. If the token was
+ * cancelled by the time the observer is destroyed, the algorithm is marked
+ * modified so that the aborted (incomplete) output will be regenerated on the
+ * next update.
+ */
+class vvCancellationToken::AbortObserver
+{
+public:
+  AbortObserver(const vvCancellationToken &token, vtkAlgorithm *algorithm);
+  ~AbortObserver();
+
+private:
+  // Not implemented:
+  AbortObserver(const AbortObserver&);
+  AbortObserver& operator=(const AbortObserver&);
+
+  vvCancellationToken m_token;
+  vtkSmartPointer<vtkAlgorithm> m_algorithm;
+  vtkSmartPointer<vtkCallbackCommand> m_command;
+  unsigned long m_observerId;
+};
+
+#endif // VVCANCELLATIONTOKEN_H
@@ -0,0 +1,144 @@
+#include "vvCompletionQueue.h"
+
+#include <Vrui/Vrui.h>
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <iterator>
+
+//------------------------------------------------------------------------------
+vvCompletionQueue::vvCompletionQueue()
+  : m_requestUpdate(&Vrui::requestUpdate)
+{
+}
+
+//------------------------------------------------------------------------------
+vvCompletionQueue::~vvCompletionQueue()
+{
+}
+
+//------------------------------------------------------------------------------
+void vvCompletionQueue::push(const void *owner, Handler handler)
+{
+  bool wasEmpty;
+
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  wasEmpty = m_pending.empty();
+  Entry entry = { owner, std::move(handler) };
+  m_pending.push_back(std::move(entry));
+  }
+
+  // Wake up the frame loop:
+  if (wasEmpty && m_requestUpdate)
+    {
+    m_requestUpdate();
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvCompletionQueue::drain(const vvApplicationState &state,
+                              Clock::time_point deadline)
+{
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_pending.empty())
+    {
+    return;
+    }
+  m_draining.swap(m_pending);
+  }
+
+  // Never leave entries behind in m_draining, they would be run again by the
+  // next drain():
+  struct ClearGuard
+  {
+    std::vector<Entry> &entries;
+    ~ClearGuard() { entries.clear(); }
+  } clearGuard = { m_draining };
+
+  // Handlers may discard entries for other owners, so iterate by index and
+  // skip handlers that have been reset. Handlers that throw (typically by
+  // rethrowing a background exception from future::get()) must not keep the
+  // others from running, so the first exception is rethrown at the end:
+  std::exception_ptr error;
+  size_t i = 0;
+  while (i < m_draining.size())
+    {
+    if (m_draining[i].handler)
+      {
+      try
+        {
+        m_draining[i++].handler(state);
+        }
+      catch (...)
+        {
+        if (!error)
+          {
+          error = std::current_exception();
+          }
+        else
+          {
+          std::cerr << "vvCompletionQueue: Dropping additional exception "
+                       "from completion handler.\n";
+          }
+        }
+      if (Clock::now() >= deadline)
+        {
+        break;
+        }
+      }
+    else
+      {
+      ++i;
+      }
+    }
+
+  // Return any handlers that did not fit before the deadline to the front of
+  // the queue, and make sure there is another frame to run them:
+  if (i < m_draining.size())
+    {
+    {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.insert(m_pending.begin(),
+                     std::make_move_iterator(m_draining.begin() + i),
+                     std::make_move_iterator(m_draining.end()));
+    }
+    if (m_requestUpdate)
+      {
+      m_requestUpdate();
+      }
+    }
+
+  m_draining.clear();
+  if (error)
+    {
+    std::rethrow_exception(error);
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvCompletionQueue::discard(const void *owner)
+{
+  for (auto &entry : m_draining)
+    {
+    if (entry.owner == owner)
+      {
+      entry.handler = nullptr;
+      }
+    }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+                                 [owner](const Entry &entry)
+                                 { return entry.owner == owner; }),
+                  m_pending.end());
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvCompletionQueue::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_pending.size();
+}
@@ -0,0 +1,92 @@
+#ifndef VVCOMPLETIONQUEUE_H
+#define VVCOMPLETIONQUEUE_H
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class vvApplicationState;
+
+/**
+ * @brief The vvCompletionQueue class delivers finished background work to the
+ * GUI thread.
+ *
+ * Worker threads push a handler onto the queue when a background job finishes.
+ * vvApplicationState::syncApplicationState() drains the queue once per frame,
+ * calling each handler from the GUI thread before any vvGLObjects are synced.
+ * This replaces polling every pending std::future every frame: the per-frame
+ * cost depends only on the number of jobs that actually completed.
+ *
+ * Pushing onto an empty queue requests a new VRUI frame, so handlers run
+ * promptly even when the application is otherwise idle. The request can be
+ * redirected with setUpdateRequestHandler(), e.g. to run without VRUI.
+ *
+ * Each handler is associated with an owner pointer. Owners must call discard()
+ * before they are destroyed to drop any handlers that have not run yet.
+ */
+class vvCompletionQueue
+{
+public:
+  using Clock = std::chrono::steady_clock;
+  using Handler = std::function<void(const vvApplicationState &)>;
+  using UpdateRequestHandler = std::function<void()>;
+
+  vvCompletionQueue();
+  ~vvCompletionQueue();
+
+  /**
+   * Queue @a handler to be called for @a owner during the next drain().
+   * Thread-safe.
+   */
+  void push(const void *owner, Handler handler);
+
+  /**
+   * Call queued handlers in the order they were pushed. Handlers pushed while
+   * draining are deferred to the next call. Once @a deadline has passed, the
+   * remaining handlers are also deferred (at least one handler is always
+   * called). If handlers throw, the first exception is rethrown once the
+   * queue is consistent again; each handler is called at most once either
+   * way. GUI thread only.
+   */
+  void drain(const vvApplicationState &state,
+             Clock::time_point deadline = Clock::time_point::max());
+
+  /**
+   * Drop all pending handlers for @a owner. GUI thread only.
+   */
+  void discard(const void *owner);
+
+  /**
+   * The number of handlers waiting for drain(). Thread-safe.
+   */
+  std::size_t size() const;
+
+  /**
+   * Called to request a new frame. Defaults to Vrui::requestUpdate(). Must
+   * not be changed while background work may push() handlers.
+   */
+  void setUpdateRequestHandler(UpdateRequestHandler handler)
+  { m_requestUpdate = std::move(handler); }
+
+private:
+  // Not implemented:
+  vvCompletionQueue(const vvCompletionQueue&);
+  vvCompletionQueue& operator=(const vvCompletionQueue&);
+
+  struct Entry
+  {
+    const void *owner;
+    Handler handler;
+  };
+
+  UpdateRequestHandler m_requestUpdate;
+
+  mutable std::mutex m_mutex;
+  std::vector<Entry> m_pending;
+
+  // Only touched from the GUI thread. Kept as a member to reuse its storage:
+  std::vector<Entry> m_draining;
+};
+
+#endif // VVCOMPLETIONQUEUE_H
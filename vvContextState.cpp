@@ -3,6 +3,8 @@
 #include <ExternalVTKWidget.h>
 #include <vtkExternalOpenGLRenderer.h>
 
+#include "vvTracer.h"
+
 vvContextState::vvContextState()
 {
   m_widget->GetRenderWindow()->AddRenderer(m_renderer.GetPointer());
@@ -18,5 +20,6 @@ vvContextState::~vvContextState()
 
 void vvContextState::render()
 {
+  vvTracer::Span span("vvContextState::render", "render");
   m_widget->GetRenderWindow()->Render();
 }
@@ -0,0 +1,371 @@
+#include "vvDiskCache.h"
+
+#include <vtkCompositeDataSet.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkGenericDataObjectReader.h>
+#include <vtkGenericDataObjectWriter.h>
+#include <vtkNew.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+namespace {
+
+// FNV-1a, which unlike std::hash is stable across runs and platforms:
+std::uint64_t hashKey(const std::string &key)
+{
+  std::uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : key)
+    {
+    hash ^= c;
+    hash *= 1099511628211ull;
+    }
+  return hash;
+}
+
+bool endsWith(const std::string &str, const std::string &suffix)
+{
+  return str.size() >= suffix.size() &&
+      str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Temporary files older than this are left over from a crashed store():
+const time_t StaleTemporaryAge = 60 * 60;
+
+bool isTemporary(const std::string &name)
+{
+  return name.find(".vtk.tmp") != std::string::npos ||
+      name.find(".key.tmp") != std::string::npos;
+}
+
+// Data sets without points are never stored, so an empty entry is corrupt:
+bool isEmpty(vtkDataObject *data)
+{
+  if (!data)
+    {
+    return true;
+    }
+  if (vtkDataSet *dataSet = vtkDataSet::SafeDownCast(data))
+    {
+    return dataSet->GetNumberOfPoints() == 0;
+    }
+  if (vtkCompositeDataSet *composite = vtkCompositeDataSet::SafeDownCast(data))
+    {
+    return composite->GetNumberOfPoints() == 0;
+    }
+  return false;
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+vvDiskCache::vvDiskCache()
+  : m_maxSize(std::size_t(4) << 30)
+{
+}
+
+//------------------------------------------------------------------------------
+vvDiskCache::~vvDiskCache()
+{
+}
+
+//------------------------------------------------------------------------------
+std::string vvDiskCache::directory() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_directory;
+}
+
+//------------------------------------------------------------------------------
+void vvDiskCache::setDirectory(const std::string &directory)
+{
+  if (!directory.empty())
+    {
+    ::mkdir(directory.c_str(), 0755); // Fails harmlessly if it exists.
+    }
+
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_directory = directory;
+  }
+  this->trim();
+}
+
+//------------------------------------------------------------------------------
+bool vvDiskCache::enabled() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return !m_directory.empty();
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvDiskCache::maxSize() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_maxSize;
+}
+
+//------------------------------------------------------------------------------
+void vvDiskCache::setMaxSize(std::size_t bytes)
+{
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_maxSize = bytes;
+  }
+  this->trim();
+}
+
+//------------------------------------------------------------------------------
+std::string vvDiskCache::makeKey(const std::string &fileName,
+                                 const std::string &parameters)
+{
+  struct stat info;
+  if (::stat(fileName.c_str(), &info) != 0)
+    {
+    return std::string();
+    }
+
+  // Files are often rewritten within a second at the same size, so include
+  // the sub-second mtime and the inode (which changes on rename-into-place):
+#ifdef __APPLE__
+  const long mtimeNanoseconds = static_cast<long>(info.st_mtimespec.tv_nsec);
+#else
+  const long mtimeNanoseconds = static_cast<long>(info.st_mtim.tv_nsec);
+#endif
+
+  std::ostringstream key;
+  key << "file=" << fileName << "\n"
+      << "size=" << info.st_size << "\n"
+      << "mtime=" << info.st_mtime << "." << std::setw(9) << std::setfill('0')
+      << mtimeNanoseconds << "\n"
+      << "inode=" << info.st_ino << "\n"
+      << "parameters=" << parameters << "\n";
+  return key.str();
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject> vvDiskCache::load(const std::string &key)
+{
+  const std::string path = this->entryPath(key);
+  if (path.empty())
+    {
+    return vtkSmartPointer<vtkDataObject>();
+    }
+
+  // Compare the full key to rule out stale entries and hash collisions:
+  std::ifstream keyFile((path + ".key").c_str(), std::ios::binary);
+  const std::string storedKey((std::istreambuf_iterator<char>(keyFile)),
+                              std::istreambuf_iterator<char>());
+
+  vtkSmartPointer<vtkDataObject> result;
+  if (keyFile && storedKey == key)
+    {
+    vtkNew<vtkGenericDataObjectReader> reader;
+    reader->SetFileName((path + ".vtk").c_str());
+    reader->ReadAllScalarsOn();
+    reader->ReadAllVectorsOn();
+    reader->ReadAllNormalsOn();
+    reader->ReadAllTensorsOn();
+    reader->ReadAllColorScalarsOn();
+    reader->ReadAllTCoordsOn();
+    reader->ReadAllFieldsOn();
+    reader->Update();
+
+    // The key matches, so a read error or missing data means the data file
+    // is truncated or corrupt. Delete the entry so it is rebuilt:
+    if (reader->GetErrorCode() == 0 && !isEmpty(reader->GetOutput()))
+      {
+      result = reader->GetOutput();
+      }
+    else
+      {
+      std::remove((path + ".key").c_str());
+      std::remove((path + ".vtk").c_str());
+      }
+    }
+
+  if (result)
+    { // Mark as recently used for trim():
+    ::utime((path + ".vtk").c_str(), nullptr);
+    }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++(result ? m_statistics.hits : m_statistics.misses);
+  return result;
+}
+
+//------------------------------------------------------------------------------
+bool vvDiskCache::store(const std::string &key, vtkDataObject *data)
+{
+  const std::string path = this->entryPath(key);
+  if (path.empty() || isEmpty(data))
+    {
+    return false;
+    }
+
+  // Unique per process and thread, so concurrent stores never collide:
+  std::ostringstream suffix;
+  suffix << ".tmp" << ::getpid() << "-"
+         << std::hash<std::thread::id>()(std::this_thread::get_id());
+  const std::string dataTmp = path + ".vtk" + suffix.str();
+  const std::string keyTmp = path + ".key" + suffix.str();
+
+  vtkNew<vtkGenericDataObjectWriter> writer;
+  writer->SetFileName(dataTmp.c_str());
+  writer->SetInputData(data);
+  writer->SetFileTypeToBinary();
+  bool ok = writer->Write() == 1;
+
+  if (ok)
+    {
+    std::ofstream keyFile(keyTmp.c_str(), std::ios::binary);
+    keyFile << key;
+    ok = static_cast<bool>(keyFile.flush());
+    }
+
+  // The key is replaced last, so an entry is never valid while its data is
+  // being replaced:
+  ok = ok && (std::remove((path + ".key").c_str()) == 0 || errno == ENOENT) &&
+      std::rename(dataTmp.c_str(), (path + ".vtk").c_str()) == 0 &&
+      std::rename(keyTmp.c_str(), (path + ".key").c_str()) == 0;
+
+  if (!ok)
+    {
+    std::remove(dataTmp.c_str());
+    std::remove(keyTmp.c_str());
+    return false;
+    }
+
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_statistics.stores;
+  }
+
+  this->trim();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+vvDiskCache::Statistics vvDiskCache::statistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_statistics;
+}
+
+//------------------------------------------------------------------------------
+std::string vvDiskCache::entryPath(const std::string &key) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_directory.empty() || key.empty())
+    {
+    return std::string();
+    }
+
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(hashKey(key)));
+  return m_directory + "/" + name;
+}
+
+//------------------------------------------------------------------------------
+void vvDiskCache::trim()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_directory.empty())
+    {
+    return;
+    }
+
+  DIR *dir = ::opendir(m_directory.c_str());
+  if (!dir)
+    {
+    return;
+    }
+
+  const time_t now = std::time(nullptr);
+
+  // (mtime, size, path without extension) of every entry:
+  struct Entry
+  {
+    time_t mtime;
+    std::size_t size;
+    std::string path;
+  };
+  std::vector<Entry> entries;
+  std::size_t total = 0;
+  while (dirent *file = ::readdir(dir))
+    {
+    const std::string name = file->d_name;
+    const bool temporary = isTemporary(name);
+    if (!temporary && !endsWith(name, ".vtk"))
+      {
+      continue;
+      }
+
+    const std::string path = m_directory + "/" + name;
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+      {
+      continue;
+      }
+
+    if (temporary)
+      { // Recent ones may belong to a store() in progress in another process:
+      if (now - info.st_mtime > StaleTemporaryAge)
+        {
+        std::remove(path.c_str());
+        }
+      else
+        {
+        total += static_cast<std::size_t>(info.st_size);
+        }
+      }
+    else
+      {
+      Entry entry;
+      entry.mtime = info.st_mtime;
+      entry.size = static_cast<std::size_t>(info.st_size);
+      entry.path = path.substr(0, path.size() - 4);
+      entries.push_back(entry);
+      total += entry.size;
+      }
+    }
+  ::closedir(dir);
+
+  if (m_maxSize == 0)
+    {
+    return;
+    }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.mtime < b.mtime; });
+  for (const Entry &entry : entries)
+    {
+    if (total <= m_maxSize)
+      {
+      break;
+      }
+    std::remove((entry.path + ".key").c_str());
+    std::remove((entry.path + ".vtk").c_str());
+    total -= entry.size;
+    ++m_statistics.evictions;
+    }
+}
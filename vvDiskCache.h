@@ -0,0 +1,112 @@
+#ifndef VVDISKCACHE_H
+#define VVDISKCACHE_H
+
+#include <vtkSmartPointer.h>
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+class vtkDataObject;
+
+/**
+ * @brief The vvDiskCache class keeps data objects on disk across runs.
+ *
+ * Entries are identified by a key string, typically made with makeKey() from
+ * the source file (its path, size, modification time and inode) and the
+ * parameters of the computation that produced the data. vvReader uses it to
+ * skip executeReducer() when the reduced data of an unchanged file is cached
+ * from a previous run, see vvReader::reductionCacheKey().
+ *
+ * Each entry is stored in the binary legacy VTK format, next to a small file
+ * holding the full key, which is checked on load so that hash collisions and
+ * stale entries are never returned. Files are written under temporary names
+ * and renamed into place, so concurrent processes and crashes never leave a
+ * partial entry behind. An entry whose data fails to load is deleted, and
+ * temporary files left by a crashed store are deleted after an hour. When the
+ * cache exceeds maxSize(), the least recently used entries are deleted.
+ *
+ * The cache is disabled until a directory is set. All methods are thread-safe.
+ * vvApplicationState owns the instance used by vtkVRUI.
+ */
+class vvDiskCache
+{
+public:
+  struct Statistics
+  {
+    std::size_t hits{0};
+    std::size_t misses{0};
+    std::size_t stores{0};
+    std::size_t evictions{0};
+  };
+
+  vvDiskCache();
+  ~vvDiskCache();
+
+  /**
+   * Directory holding the cache files. It is created if it does not exist
+   * (its parent must exist). Empty (the default) disables the cache.
+   * @{
+   */
+  std::string directory() const;
+  void setDirectory(const std::string &directory);
+  /** @} */
+
+  /** True if a directory is set. */
+  bool enabled() const;
+
+  /**
+   * Total size of the cache files in bytes before old entries are deleted.
+   * Default is 4 GiB; 0 is unlimited.
+   * @{
+   */
+  std::size_t maxSize() const;
+  void setMaxSize(std::size_t bytes);
+  /** @} */
+
+  /**
+   * Make a key for data computed from @a fileName with @a parameters. The key
+   * changes whenever the file is modified or replaced: it includes the file's
+   * size, modification time to the nanosecond (where the file system records
+   * it) and inode. Returns an empty string if the
+   * file does not exist.
+   */
+  static std::string makeKey(const std::string &fileName,
+                             const std::string &parameters);
+
+  /**
+   * Return the data stored for @a key, or nullptr if there is none or the
+   * cache is disabled.
+   */
+  vtkSmartPointer<vtkDataObject> load(const std::string &key);
+
+  /**
+   * Store @a data for @a key, replacing any previous entry. @a data is only
+   * read. Returns false if the cache is disabled, @a data is a data set without
+   * points, or the write fails.
+   */
+  bool store(const std::string &key, vtkDataObject *data);
+
+  Statistics statistics() const;
+
+private:
+  // Not implemented:
+  vvDiskCache(const vvDiskCache&);
+  vvDiskCache& operator=(const vvDiskCache&);
+
+  /** Path of the entry for @a key without extension, or empty if disabled. */
+  std::string entryPath(const std::string &key) const;
+
+  /**
+   * Delete stale temporary files, then least recently used entries until the
+   * cache fits maxSize().
+   */
+  void trim();
+
+  mutable std::mutex m_mutex;
+  std::string m_directory;
+  std::size_t m_maxSize;
+  Statistics m_statistics;
+};
+
+#endif // VVDISKCACHE_H
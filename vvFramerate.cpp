@@ -7,17 +7,31 @@
 
 #include <GL/GLContextData.h>
 
-#include <Vrui/Vrui.h>
-
 #include "vvApplicationState.h"
 #include "vvContextState.h"
 
 #include <algorithm>
 #include <cassert>
-#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Nearest-rank percentile of sorted values:
+double percentile(const double *sorted, std::size_t count, double p)
+{
+  std::size_t rank = static_cast<std::size_t>(std::ceil(p * count));
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+} // end anon namespace
+
+constexpr std::size_t vvFramerate::WindowSize;
 
 //------------------------------------------------------------------------------
 vvFramerate::DataItem::DataItem()
+  : textRevision(0)
 {
   actor->SetTextScaleModeToViewport();
   vtkCoordinate *coord = actor->GetPositionCoordinate();
@@ -27,8 +41,19 @@ vvFramerate::DataItem::DataItem()
 
 //------------------------------------------------------------------------------
 vvFramerate::vvFramerate()
-  : m_visible(false)
+  : m_numTimes(0),
+    m_nextTime(0),
+    m_timeSum(0.),
+    m_overBudget(0),
+    m_totalFrames(0),
+    m_totalOverBudget(0),
+    m_frameTimeBudget(1. / 90.),
+    m_textRevision(0),
+    m_visible(false)
 {
+  m_times.fill(0.);
+  m_text.fill('\0');
+
   m_tprop->SetJustificationToLeft();
   m_tprop->SetVerticalJustificationToTop();
   m_tprop->SetFontSize(8);
@@ -62,8 +87,6 @@ void vvFramerate::syncApplicationState(const vvApplicationState &state)
 {
   this->Superclass::syncApplicationState(state);
 
-  const size_t FPSCacheSize = 64;
-
   m_timer.elapse();
   const double time = m_timer.getTime();
 
@@ -71,20 +94,53 @@ void vvFramerate::syncApplicationState(const vvApplicationState &state)
     {
     return;
     }
-  else if (m_times.size() < FPSCacheSize)
+
+  // Replace the oldest frame time, if the window is full:
+  if (m_numTimes == WindowSize)
     {
-    m_times.push_back(time);
+    const double oldest = m_times[m_nextTime];
+    m_timeSum -= oldest;
+    if (oldest > m_frameTimeBudget)
+      {
+      --m_overBudget;
+      }
     }
   else
     {
-    std::rotate(m_times.begin(), m_times.begin() + 1, m_times.end());
-    m_times.back() = time;
+    ++m_numTimes;
     }
 
-  // If showing the framerate, trigger another render:
+  m_times[m_nextTime] = time;
+  m_nextTime = (m_nextTime + 1) % WindowSize;
+  m_timeSum += time;
+  ++m_totalFrames;
+  if (time > m_frameTimeBudget)
+    {
+    ++m_overBudget;
+    ++m_totalOverBudget;
+    }
+
+  // If showing the framerate, update the text and trigger another render:
   if (m_visible)
     {
-    Vrui::requestUpdate();
+    const Statistics stats = this->statistics();
+
+    std::array<char, 160> text;
+    std::snprintf(text.data(), text.size(),
+                  "FPS: %.1f\n"
+                  "Frame: %.1f ms (p95 %.1f, p99 %.1f, max %.1f)\n"
+                  "Over %.1f ms: %zu/%zu",
+                  stats.meanFPS, stats.meanFrameTime * 1e3,
+                  stats.p95FrameTime * 1e3, stats.p99FrameTime * 1e3,
+                  stats.maxFrameTime * 1e3, m_frameTimeBudget * 1e3,
+                  stats.overBudget, stats.frames);
+    if (std::strcmp(text.data(), m_text.data()) != 0)
+      {
+      m_text = text;
+      ++m_textRevision;
+      }
+
+    state.requestUpdate();
     }
 }
 
@@ -99,17 +155,54 @@ void vvFramerate::syncContextState(const vvApplicationState &appState,
   assert(dataItem);
 
   dataItem->actor->SetVisibility(m_visible ? 1 : 0);
-  if (m_visible)
+  if (m_visible && dataItem->textRevision != m_textRevision)
     {
-    double time = 0.0;
-    for (size_t i = 0; i < m_times.size(); ++i)
+    dataItem->actor->SetInput(m_text.data());
+    dataItem->textRevision = m_textRevision;
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvFramerate::setFrameTimeBudget(double seconds)
+{
+  m_frameTimeBudget = seconds;
+
+  m_overBudget = 0;
+  for (std::size_t i = 0; i < m_numTimes; ++i)
+    {
+    if (m_times[i] > m_frameTimeBudget)
       {
-      time += m_times[i];
+      ++m_overBudget;
       }
-    double fps = time > 1e-5 ? m_times.size() / time : 0.;
+    }
+}
 
-    std::ostringstream fpsStr;
-    fpsStr << "FPS: " << fps;
-    dataItem->actor->SetInput(fpsStr.str().c_str());
+//------------------------------------------------------------------------------
+vvFramerate::Statistics vvFramerate::statistics() const
+{
+  Statistics result;
+  result.frames = m_numTimes;
+  result.overBudget = m_overBudget;
+  result.totalFrames = m_totalFrames;
+  result.totalOverBudget = m_totalOverBudget;
+
+  if (m_numTimes == 0)
+    {
+    return result;
     }
+
+  result.meanFrameTime = m_timeSum / m_numTimes;
+  result.meanFPS = m_timeSum > 1e-5 ? m_numTimes / m_timeSum : 0.;
+
+  // The window is small, so sorting a copy is cheap and allocation-free:
+  std::array<double, WindowSize> sorted;
+  std::copy(m_times.begin(), m_times.begin() + m_numTimes, sorted.begin());
+  std::sort(sorted.begin(), sorted.begin() + m_numTimes);
+
+  result.minFrameTime = sorted[0];
+  result.maxFrameTime = sorted[m_numTimes - 1];
+  result.p95FrameTime = percentile(sorted.data(), m_numTimes, 0.95);
+  result.p99FrameTime = percentile(sorted.data(), m_numTimes, 0.99);
+
+  return result;
 }
@@ -7,23 +7,51 @@
 
 #include <vtkNew.h>
 
-#include <vector>
+#include <array>
+#include <cstddef>
 
 class vtkTextActor;
 class vtkTextProperty;
 
 /**
  * @brief The vvFramerate class renders the framerate as a vtkTextActor.
+ *
+ * Frame times of the last WindowSize frames are kept in a ring buffer. Besides
+ * the mean framerate, the overlay shows the frame time percentiles and the
+ * number of frames that exceeded frameTimeBudget(), since occasional hitches
+ * are what make VR uncomfortable.
  */
 class vvFramerate : public vvGLObject
 {
 public:
   using Superclass = vvGLObject;
 
+  /** Number of recent frames used for statistics(). */
+  static constexpr std::size_t WindowSize = 64;
+
+  /**
+   * Frame time statistics over the last WindowSize frames. Times are in
+   * seconds.
+   */
+  struct Statistics
+  {
+    std::size_t frames{0}; // Frames in the window.
+    double meanFPS{0.};
+    double meanFrameTime{0.};
+    double minFrameTime{0.};
+    double maxFrameTime{0.};
+    double p95FrameTime{0.};
+    double p99FrameTime{0.};
+    std::size_t overBudget{0}; // Frames in the window over the budget.
+    std::size_t totalFrames{0}; // Frames since construction.
+    std::size_t totalOverBudget{0}; // Over-budget frames since construction.
+  };
+
   struct DataItem : public Superclass::DataItem
   {
     DataItem();
     vtkNew<vtkTextActor> actor;
+    unsigned long textRevision; // m_textRevision of the actor's input.
   };
 
   vvFramerate();
@@ -33,6 +61,7 @@ public:
   void initVvContext(vvContextState &vvContext,
                      GLContextData &contextData) const override;
   void syncApplicationState(const vvApplicationState &state) override;
+  bool deferrable() const override { return false; }
   void syncContextState(const vvApplicationState &appState,
                         const vvContextState &contextState,
                         GLContextData &contextData) const override;
@@ -43,6 +72,20 @@ public:
   bool visible() const { return m_visible; }
   void setVisible(bool visible) { m_visible = visible; }
 
+  /**
+   * Frames that take longer than this are counted as over budget. Default is
+   * 1/90 s (11.1 ms) for a 90 Hz headset. Changing the budget recounts the
+   * over-budget frames in the window; the total since construction counts
+   * each frame against the budget in effect when it was recorded.
+   * @{
+   */
+  double frameTimeBudget() const { return m_frameTimeBudget; }
+  void setFrameTimeBudget(double seconds);
+  /** @} */
+
+  /** Compute the current frame time statistics. */
+  Statistics statistics() const;
+
 private:
   // Not implemented -- disable copy:
   vvFramerate(const vvFramerate&);
@@ -50,7 +93,20 @@ private:
 
 private:
   Misc::Timer m_timer;
-  std::vector<double> m_times;
+
+  // Ring buffer of recent frame times with running sum and over-budget count:
+  std::array<double, WindowSize> m_times;
+  std::size_t m_numTimes;
+  std::size_t m_nextTime;
+  double m_timeSum;
+  std::size_t m_overBudget;
+  std::size_t m_totalFrames;
+  std::size_t m_totalOverBudget;
+  double m_frameTimeBudget;
+
+  // Formatted once per frame; only passed to the actors when it changes:
+  std::array<char, 160> m_text;
+  unsigned long m_textRevision;
 
   vtkNew<vtkTextProperty> m_tprop;
   bool m_visible;
@@ -37,6 +37,12 @@ void vvGLObject::syncApplicationState(const vvApplicationState &)
 {
 }
 
+//------------------------------------------------------------------------------
+bool vvGLObject::deferrable() const
+{
+  return true;
+}
+
 //------------------------------------------------------------------------------
 void vvGLObject::syncContextState(const vvApplicationState &,
                                   const vvContextState &,
@@ -84,6 +84,13 @@ public:
    */
   virtual void syncApplicationState(const vvApplicationState &state);
 
+  /**
+   * Return false if syncApplicationState must run every frame. Otherwise, it
+   * may be postponed to a later frame when vvApplicationState's frame budget
+   * is exhausted. Default is true.
+   */
+  virtual bool deferrable() const;
+
   /**
    * Prepare the context state for rendering. Called per-frame, per-context from
    * vvApplication::display(), after syncing application state but before
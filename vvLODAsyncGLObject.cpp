@@ -2,60 +2,97 @@
 
 #include <GL/GLContextData.h>
 
-#include <Vrui/Vrui.h>
-
 #include "vvApplicationState.h"
+#include "vvCompletionQueue.h"
 #include "vvContextState.h"
+#include "vvMemoryManager.h"
 #include "vvProgress.h"
 #include "vvProgressCookie.h"
+#include "vvThreadPool.h"
+#include "vvTracer.h"
 
-#include <vtkTimerLog.h>
-
+#include <algorithm>
 #include <cassert>
-#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <type_traits>
 
 namespace {
-template <typename T, size_t N>
-void deleteLODArray(std::array<T*, N> &a) noexcept(true)
+template <typename T>
+void deleteLODArray(std::vector<T*> &a) noexcept(true)
 {
-  for (T *o: a)
+  for (T *&o: a)
     {
     delete o;
+    o = nullptr;
     }
-  a.fill(nullptr);
 }
 
-std::ostream& operator<<(std::ostream &str,
-                         vvLODAsyncGLObject::LevelOfDetail lod)
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+vvLODAsyncGLObject::LODData::~LODData()
 {
-  switch (lod)
-    {
-    case vvLODAsyncGLObject::LevelOfDetail::Hint:
-      return (str << "Hint");
-    case vvLODAsyncGLObject::LevelOfDetail::LoRes:
-      return (str << "LoRes");
-    case vvLODAsyncGLObject::LevelOfDetail::HiRes:
-      return (str << "HiRes");
-    default:
-      return (str << "Invalid");
-    }
 }
 
-} // end anon namespace
+//------------------------------------------------------------------------------
+std::size_t vvLODAsyncGLObject::LODData::memorySize() const
+{
+  return 0;
+}
 
 //------------------------------------------------------------------------------
 vvLODAsyncGLObject::DataPipeline::~DataPipeline()
 {
 }
 
+//------------------------------------------------------------------------------
+std::string vvLODAsyncGLObject::DataPipeline::cacheKey() const
+{
+  return std::string();
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::DataPipeline::adoptRestoredResult(const LODData &)
+{
+}
+
+//------------------------------------------------------------------------------
+double vvLODAsyncGLObject::DataPipeline::inputSize() const
+{
+  return 1.;
+}
+
+//------------------------------------------------------------------------------
+bool vvLODAsyncGLObject::DataPipeline::isObsolete(const ObjectState &) const
+{
+  return false;
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::DataPipeline::exportPartialResult(LODData &) const
+{
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::DataPipeline::publishPartialResult()
+{
+  if (m_partialResultPublisher)
+    {
+    m_partialResultPublisher();
+    }
+}
+
 //------------------------------------------------------------------------------
 vvLODAsyncGLObject::RenderPipeline::~RenderPipeline()
 {
 }
 
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::RenderPipeline::release()
+{
+}
+
 //------------------------------------------------------------------------------
 vvLODAsyncGLObject::DataItem::~DataItem()
 {
@@ -64,24 +101,69 @@ vvLODAsyncGLObject::DataItem::~DataItem()
 
 //------------------------------------------------------------------------------
 vvLODAsyncGLObject::vvLODAsyncGLObject()
-  : m_benchmark(false)
+  : m_priority(0),
+    m_benchmark(false)
 {
 }
 
 //------------------------------------------------------------------------------
 vvLODAsyncGLObject::~vvLODAsyncGLObject()
 {
+  // Stop background updates before dropping their completion handlers:
+  for (auto lod = this->bestToFast(/*skipInvalid =*/ false); lod; ++lod)
+    {
+    if (lod->monitor.valid())
+      {
+      lod->token.cancel();
+      lod->monitor.wait();
+      }
+    }
+
+  if (m_completionQueue)
+    {
+    m_completionQueue->discard(this);
+    }
+
+  if (m_memoryManager)
+    {
+    m_memoryManager->untrackAll(this);
+    }
+
+  if (m_benchmark && m_statistics)
+    {
+    m_statistics->dump(std::cerr, m_statisticsPrefix + "/");
+    }
+
   delete m_objState;
 }
 
 //------------------------------------------------------------------------------
-void vvLODAsyncGLObject::init(const vvApplicationState &)
+void vvLODAsyncGLObject::init(const vvApplicationState &appState)
 {
+  m_memoryManager = &appState.memoryManager();
+  m_statistics = &appState.statistics();
+  m_statisticsPrefix = m_statistics->uniquePrefix(this->progressLabel());
+
   m_objState = this->createObjectState();
   assert("createObjectState() result valid." && m_objState);
 
+  // DataPipelineManager is not movable, so construct the array in place:
+  assert("Not initialized." && m_dataPipelines.empty());
+  LODArray<DataPipelineManager>(this->levelOfDetailCount())
+      .swap(m_dataPipelines);
+
   for (auto lod = this->bestToFast(/*skipInvalid =*/ false); lod; ++lod)
     {
+    lod->cache.maxEntries = m_resultCacheSize;
+    lod->cache.maxMemory = m_resultCacheMemoryLimit;
+
+    const std::string series =
+        m_statisticsPrefix + "/" + this->levelOfDetailName(lod) + "/";
+    lod->queueWaitSeries = series + "queueWait";
+    lod->executeSeries = series + "execute";
+    lod->exportResultSeries = series + "exportResult";
+    lod->timeToVisibleSeries = series + "timeToVisible";
+
     DataPipeline *dp = this->createDataPipeline(lod);
     if (dp)
       {
@@ -89,6 +171,15 @@ void vvLODAsyncGLObject::init(const vvApplicationState &)
       lod->dataPipeline = dp;
       lod->result = this->createLODData(lod);
       assert("createLODData result valid." && lod->result);
+
+      if (!dp->forceSynchronousUpdates())
+        {
+        const LevelOfDetail lodIndex = lod;
+        dp->m_partialResultPublisher = [this, lodIndex]()
+          {
+          this->queuePartialResult(lodIndex);
+          };
+        }
       }
     }
 }
@@ -102,7 +193,7 @@ void vvLODAsyncGLObject::initVvContext(vvContextState &contextState,
   assert("Duplicate context initialization detected!" &&
          !contextData.retrieveDataItem<DataItem>(this));
 
-  DataItem *dataItem = new DataItem;
+  DataItem *dataItem = new DataItem(m_dataPipelines.size());
   contextData.addDataItem(this, dataItem);
 
   for (auto lod = this->bestToFast(); lod; ++lod)
@@ -122,31 +213,17 @@ void vvLODAsyncGLObject::syncApplicationState(const vvApplicationState &state)
   // Grab the best detail data pipeline.
   auto lod = this->bestToFast();
 
-  // Iterate through all LODs and complete any pending updates. This prevents
-  // progress cookies from lingering if a `better` LOD finishes before a
-  // 'faster' one:
+  // Finished updates have already been collected by completeUpdate(). Cancel
+  // any remaining ones that are working on stale parameters:
+  bool changed = false;
   for (; lod; ++lod)
     {
-    if (lod->status == LODStatus::Updating)
+    if (lod->status == LODStatus::Updating && !lod->token.cancelled() &&
+        lod->dataPipeline->isObsolete(*m_objState))
       {
-      assert("Thread has been started." && lod->monitor.valid());
-
-      // Check state:
-      std::chrono::seconds now(0);
-      std::future_status fState = lod->monitor.wait_for(now);
-
-      // We should never use deferred execution:
-      assert("Always async." && fState != std::future_status::deferred);
-
-      if (fState == std::future_status::ready)
-        { // Update the result if done:
-        lod->monitor.get(); // Reset thread state
-        lod->dataPipeline->exportResult(*lod->result);
-        lod->status = LODStatus::UpToDate;
-        assert("Cookie created." && lod->cookie != nullptr);
-        state.progress().removeEntry(lod->cookie);
-        lod->cookie = nullptr;
-        }
+      lod->token.cancel();
+      dropPartialResult(*lod); // Stale, stop showing it
+      changed = true;
       }
     }
 
@@ -161,6 +238,12 @@ void vvLODAsyncGLObject::syncApplicationState(const vvApplicationState &state)
       if (lod->dataPipeline->needsUpdate(*m_objState, *lod->result))
         {
         lod->status = LODStatus::OutOfDate;
+        markStale(*lod);
+        changed = true;
+        }
+      else
+        { // A change carried over by markResultReady() did not affect it:
+        lod->staleSince = vvStatistics::Clock::time_point();
         }
       }
 
@@ -172,6 +255,21 @@ void vvLODAsyncGLObject::syncApplicationState(const vvApplicationState &state)
       }
     }
 
+  // The parameters changed, so the updates running now will export stale
+  // results. Remember when, to time the change once they are relaunched:
+  if (changed)
+    {
+    const vvStatistics::Clock::time_point now = vvStatistics::Clock::now();
+    for (auto it = this->bestToFast(); it; ++it)
+      {
+      if (it->status == LODStatus::Updating &&
+          it->changedWhileUpdating == vvStatistics::Clock::time_point())
+        {
+        it->changedWhileUpdating = now;
+        }
+      }
+    }
+
   // At this point, lod is pointing at either the up-to-date, live copy
   // of the best LOD available, or has exhausted available LODs (all are
   // updating or out-of-date).
@@ -195,25 +293,53 @@ void vvLODAsyncGLObject::syncApplicationState(const vvApplicationState &state)
       lod->dataPipeline->configure(*m_objState, state);
       if (lod->dataPipeline->needsUpdate(*m_objState, *lod->result))
         { // If an update is needed, execute the pipeline
-        if (lod->dataPipeline->forceSynchronousUpdates())
+        markStale(*lod);
+        if (this->restoreCachedResult(lod, *lod))
+          { // Seen these parameters before:
+          lod->status = LODStatus::UpToDate;
+          }
+        else if (lod->dataPipeline->forceSynchronousUpdates())
           { // Run immediately:
-          this->executeWrapper(lod, lod->dataPipeline);
-          lod->dataPipeline->exportResult(*lod->result);
+          lod->executeInputSize = lod->dataPipeline->inputSize();
+          this->executeWrapper(lod, lod->dataPipeline, vvCancellationToken());
+          updateExecutionEstimate(*lod);
+          this->exportResult(lod, *lod);
           lod->status = LODStatus::UpToDate;
           }
         else
           { // Run in background:
           assert("Cookie cleaned up." && lod->cookie == nullptr);
 
-          std::ostringstream progLabel;
-          progLabel << "Updating " << this->progressLabel() << " ("
-                    << static_cast<LevelOfDetail>(lod) << ")";
-          lod->cookie = state.progress().addEntry(progLabel.str());
-          assert("Cookie assigned." && lod->cookie != nullptr);
+          // The label may depend on the parameters; rebuild only on change:
+          std::string label = this->progressLabel();
+          if (label != lod->progressLabel || lod->progressText.empty())
+            {
+            lod->progressText = "Updating " + label + " (" +
+                this->levelOfDetailName(lod) + ")";
+            lod->progressLabel.swap(label);
+            }
 
-          lod->monitor = std::async(std::launch::async,
-                                    &vvLODAsyncGLObject::executeWrapper,
-                                    this, lod, lod->dataPipeline);
+          lod->cookie = state.progress().addEntry(lod->progressText);
+          assert("Cookie assigned." && lod->cookie != nullptr);
+          lod->dataPipeline->m_progressCookie = lod->cookie;
+          lod->executeInputSize = lod->dataPipeline->inputSize();
+          lod->cookie->setEstimatedDuration(
+                this->estimatedExecutionTime(lod));
+
+          // Faster LODs are scheduled first, across all objects:
+          vvThreadPool::Priority priority(
+                m_dataPipelines.size() - 1 - static_cast<size_t>(lod),
+                m_priority, this->screenRelevance(state));
+
+          // This run sees every change so far; staleSince keeps the first:
+          lod->changedWhileUpdating = vvStatistics::Clock::time_point();
+
+          m_completionQueue = &state.completionQueue();
+          lod->token = vvCancellationToken();
+          lod->monitor = state.threadPool().submit(
+                priority, &vvLODAsyncGLObject::backgroundExecute, this,
+                static_cast<LevelOfDetail>(lod), lod->dataPipeline, lod->token,
+                vvStatistics::Clock::now());
           lod->status = LODStatus::Updating;
           }
         }
@@ -221,6 +347,7 @@ void vvLODAsyncGLObject::syncApplicationState(const vvApplicationState &state)
         {
         // LOD is suddenly and inexplicably up-to-date! Isn't that magical...
         lod->status = LODStatus::UpToDate;
+        markResultReady(*lod);
         }
       }
     }
@@ -236,12 +363,13 @@ void vvLODAsyncGLObject::syncContextState(const vvApplicationState &appState,
   DataItem *dataItem = contextData.retrieveDataItem<DataItem>(this);
   assert(dataItem);
 
-  // Do nothing if there is not up-to-date LOD (prevents the dataset from
-  // flickering, since out-of-date data will be shown while we wait).
+  // Do nothing if there is no up-to-date LOD or partial result (prevents the
+  // dataset from flickering, since out-of-date data will be shown while we
+  // wait).
   bool hasLive = false;
   for (const_iterator lod = this->bestToFast(); lod; ++lod)
     {
-    if (lod->status == LODStatus::UpToDate)
+    if (renderableData(*lod))
       {
       hasLive = true;
       break;
@@ -254,79 +382,500 @@ void vvLODAsyncGLObject::syncContextState(const vvApplicationState &appState,
     return;
     }
 
-  // Show the best up-to-date LOD:
+  // Show the best up-to-date LOD, or a better partial result:
   bool liveSet = false;
   for (const_iterator lod = this->bestToFast(); lod; ++lod)
     {
     RenderPipeline *rp = dataItem->renderPipeline(lod);
+    const LODData *data = liveSet ? nullptr : renderableData(*lod);
 
-    if (!liveSet && lod->status == LODStatus::UpToDate)
+    if (data)
       {
-      rp->update(*m_objState, appState, contextState, *lod->result);
+      vvTracer::Span span("RenderPipeline::update", "render",
+                          m_statisticsPrefix);
+      rp->update(*m_objState, appState, contextState, *data);
       liveSet = true;
+
+      // Record the staleness latency the first time a result is shown:
+      if (data == lod->result)
+        {
+        const vvStatistics::Clock::rep since =
+            lod->pendingVisibleSince.exchange(0);
+        if (since != 0)
+          {
+          m_statistics->record(
+                lod->timeToVisibleSeries,
+                vvStatistics::elapsed(vvStatistics::Clock::time_point(
+                                        vvStatistics::Clock::duration(since))));
+          }
+        }
       }
     else
       {
       rp->disable();
+
+      // Let go of an evicted result, so that its memory is actually freed:
+      const unsigned int evictions = lod->evictions;
+      if (dataItem->releasedEvictions[lod] != evictions)
+        {
+        rp->release();
+        dataItem->releasedEvictions[lod] = evictions;
+        }
       }
     }
 }
 
+//------------------------------------------------------------------------------
+std::size_t vvLODAsyncGLObject::levelOfDetailCount() const
+{
+  return static_cast<std::size_t>(LevelOfDetail::Count);
+}
+
+//------------------------------------------------------------------------------
+std::string vvLODAsyncGLObject::levelOfDetailName(LevelOfDetail lod) const
+{
+  if (m_dataPipelines.size() == static_cast<size_t>(LevelOfDetail::Count))
+    {
+    switch (lod)
+      {
+      case LevelOfDetail::Hint:
+        return "Hint";
+      case LevelOfDetail::LoRes:
+        return "LoRes";
+      case LevelOfDetail::HiRes:
+        return "HiRes";
+      default:
+        break;
+      }
+    }
+
+  std::ostringstream name;
+  name << "LOD " << static_cast<size_t>(lod);
+  return name.str();
+}
+
+//------------------------------------------------------------------------------
+double vvLODAsyncGLObject::screenRelevance(const vvApplicationState &) const
+{
+  return 0.;
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::setResultCacheSize(std::size_t entries)
+{
+  m_resultCacheSize = entries;
+  for (auto lod = this->bestToFast(/*skipInvalid =*/ false); lod; ++lod)
+    {
+    lod->cache.maxEntries = entries;
+    lod->cache.trim();
+    this->trackResultCache(lod, *lod);
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::setResultCacheMemoryLimit(std::size_t bytes)
+{
+  m_resultCacheMemoryLimit = bytes;
+  for (auto lod = this->bestToFast(/*skipInvalid =*/ false); lod; ++lod)
+    {
+    lod->cache.maxMemory = bytes;
+    lod->cache.trim();
+    this->trackResultCache(lod, *lod);
+    }
+}
+
+//------------------------------------------------------------------------------
+vvStatistics::Summary vvLODAsyncGLObject::timeToVisible(LevelOfDetail lod) const
+{
+  const size_t index = static_cast<size_t>(lod);
+  return m_statistics && index < m_dataPipelines.size()
+      ? m_statistics->summary(m_dataPipelines[index].timeToVisibleSeries)
+      : vvStatistics::Summary();
+}
+
+//------------------------------------------------------------------------------
+double vvLODAsyncGLObject::estimatedExecutionTime(LevelOfDetail lodIndex) const
+{
+  if (static_cast<size_t>(lodIndex) >= m_dataPipelines.size())
+    {
+    return -1.;
+    }
+
+  const DataPipelineManager &lod =
+      m_dataPipelines[static_cast<size_t>(lodIndex)];
+  if (!lod.dataPipeline)
+    {
+    return -1.;
+    }
+
+  return lod.executionEstimate.estimate(lod.dataPipeline->inputSize());
+}
+
+//------------------------------------------------------------------------------
+double vvLODAsyncGLObject::estimatedTimeRemaining(LevelOfDetail lodIndex) const
+{
+  if (static_cast<size_t>(lodIndex) >= m_dataPipelines.size())
+    {
+    return -1.;
+    }
+
+  const DataPipelineManager &lod =
+      m_dataPipelines[static_cast<size_t>(lodIndex)];
+  if (lod.status != LODStatus::Updating || !lod.cookie)
+    {
+    return -1.;
+    }
+
+  return lod.cookie->estimatedTimeRemaining();
+}
+
+//------------------------------------------------------------------------------
+vvLODAsyncGLObject::ResultCacheStatistics
+vvLODAsyncGLObject::resultCacheStatistics(LevelOfDetail lod) const
+{
+  const size_t index = static_cast<size_t>(lod);
+  return index < m_dataPipelines.size() ? m_dataPipelines[index].cache.stats
+                                        : ResultCacheStatistics();
+}
+
 //------------------------------------------------------------------------------
 vvLODAsyncGLObject::LODData *vvLODAsyncGLObject::lodData(LevelOfDetail lod)
 {
-  return m_dataPipelines[static_cast<size_t>(lod)].result;
+  const size_t index = static_cast<size_t>(lod);
+  return index < m_dataPipelines.size() ? m_dataPipelines[index].result
+                                        : nullptr;
 }
 
 //------------------------------------------------------------------------------
 const vvLODAsyncGLObject::LODData *
 vvLODAsyncGLObject::lodData(LevelOfDetail lod) const
 {
-  return m_dataPipelines[static_cast<size_t>(lod)].result;
+  const size_t index = static_cast<size_t>(lod);
+  return index < m_dataPipelines.size() ? m_dataPipelines[index].result
+                                        : nullptr;
 }
 
 //------------------------------------------------------------------------------
 vvLODAsyncGLObject::DataPipeline *
 vvLODAsyncGLObject::dataPipeline(LevelOfDetail lod)
 {
-  return m_dataPipelines[static_cast<size_t>(lod)].dataPipeline;
+  const size_t index = static_cast<size_t>(lod);
+  return index < m_dataPipelines.size() ? m_dataPipelines[index].dataPipeline
+                                        : nullptr;
 }
 
 //------------------------------------------------------------------------------
 const vvLODAsyncGLObject::DataPipeline *
 vvLODAsyncGLObject::dataPipeline(LevelOfDetail lod) const
 {
-  return m_dataPipelines[static_cast<size_t>(lod)].dataPipeline;
+  const size_t index = static_cast<size_t>(lod);
+  return index < m_dataPipelines.size() ? m_dataPipelines[index].dataPipeline
+                                        : nullptr;
+}
+
+//------------------------------------------------------------------------------
+bool vvLODAsyncGLObject::restoreCachedResult(LevelOfDetail lodIndex,
+                                             DataPipelineManager &lod)
+{
+  lod.pendingKey.clear();
+  if (m_resultCacheSize == 0)
+    {
+    return false;
+    }
+
+  std::string key = lod.dataPipeline->cacheKey();
+  if (key.empty())
+    {
+    return false;
+    }
+
+  LODData *cached = lod.cache.take(key);
+  if (cached == nullptr)
+    {
+    ++lod.cache.stats.misses;
+    lod.pendingKey.swap(key);
+    return false;
+    }
+
+  ++lod.cache.stats.hits;
+
+  // Swap the cached result in, caching the current one if possible:
+  if (lod.resultKey.empty())
+    {
+    delete lod.result;
+    }
+  else
+    {
+    lod.cache.insert(lod.resultKey, lod.result);
+    }
+  lod.result = cached;
+  lod.resultKey.swap(key);
+  lod.dataPipeline->adoptRestoredResult(*lod.result);
+  this->trackResult(lodIndex, lod);
+  this->trackResultCache(lodIndex, lod);
+  markResultReady(lod);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::updateExecutionEstimate(DataPipelineManager &lod)
+{
+  lod.executionEstimate.record(lod.executeSeconds, lod.executeInputSize);
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::exportResult(LevelOfDetail lodIndex,
+                                      DataPipelineManager &lod)
+{
+  // Keep the current result around if it can be restored later:
+  if (!lod.resultKey.empty() && m_resultCacheSize > 0)
+    {
+    lod.cache.insert(lod.resultKey, lod.result);
+    lod.result = this->createLODData(lodIndex);
+    assert("createLODData result valid." && lod.result);
+    this->trackResultCache(lodIndex, lod);
+    }
+
+  vvTracer::Span span("DataPipeline::exportResult", "pipeline",
+                      lod.exportResultSeries);
+  const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+  lod.dataPipeline->exportResult(*lod.result);
+  m_statistics->record(lod.exportResultSeries, vvStatistics::elapsed(start));
+  lod.resultKey.swap(lod.pendingKey);
+  lod.pendingKey.clear();
+  this->trackResult(lodIndex, lod);
+  markResultReady(lod);
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::markStale(DataPipelineManager &lod)
+{
+  if (lod.staleSince == vvStatistics::Clock::time_point())
+    {
+    lod.staleSince = vvStatistics::Clock::now();
+    lod.pendingVisibleSince = 0; // The previous result will not be shown
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::markResultReady(DataPipelineManager &lod)
+{
+  if (lod.staleSince != vvStatistics::Clock::time_point())
+    {
+    lod.pendingVisibleSince = lod.staleSince.time_since_epoch().count();
+    }
+
+  // Changes made while this result was computed are not reflected in it:
+  lod.staleSince = lod.changedWhileUpdating;
+  lod.changedWhileUpdating = vvStatistics::Clock::time_point();
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::trackResult(LevelOfDetail lodIndex,
+                                     DataPipelineManager &lod)
+{
+  m_memoryManager->track(this, static_cast<unsigned int>(lodIndex),
+                         lod.result->memorySize(),
+                         [this, lodIndex]()
+                         { return this->evictResult(lodIndex); });
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::trackResultCache(LevelOfDetail lodIndex,
+                                          DataPipelineManager &lod)
+{
+  if (!m_memoryManager)
+    { // Not initialized yet; the caches are empty.
+    return;
+    }
+
+  const unsigned int slot = static_cast<unsigned int>(
+        m_dataPipelines.size() + static_cast<size_t>(lodIndex));
+  if (lod.cache.entries.empty())
+    {
+    m_memoryManager->untrack(this, slot);
+    return;
+    }
+
+  m_memoryManager->track(this, slot, lod.cache.stats.memorySize,
+                         [this, lodIndex]()
+                         { return this->evictResultCache(lodIndex); });
+}
+
+//------------------------------------------------------------------------------
+bool vvLODAsyncGLObject::evictResult(LevelOfDetail lodIndex)
+{
+  DataPipelineManager &lod = m_dataPipelines[static_cast<size_t>(lodIndex)];
+
+  // The result will be replaced (and re-tracked) by the running update:
+  if (lod.status == LODStatus::Updating)
+    {
+    return false;
+    }
+
+  // Never release the live LOD:
+  for (auto it = this->bestToFast(); it; ++it)
+    {
+    if (it->status == LODStatus::UpToDate)
+      {
+      if (static_cast<LevelOfDetail>(it) == lodIndex)
+        {
+        return false;
+        }
+      break;
+      }
+    }
+
+  delete lod.result;
+  lod.result = this->createLODData(lodIndex);
+  assert("createLODData result valid." && lod.result);
+  lod.resultKey.clear();
+  lod.status = LODStatus::OutOfDate;
+  ++lod.evictions;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vvLODAsyncGLObject::evictResultCache(LevelOfDetail lodIndex)
+{
+  // Cached results are never live, so they can always be released:
+  ResultCache &cache = m_dataPipelines[static_cast<size_t>(lodIndex)].cache;
+  cache.stats.evictions += cache.entries.size();
+  cache.clear();
+  return true;
 }
 
 //------------------------------------------------------------------------------
 void vvLODAsyncGLObject::executeWrapper(LevelOfDetail lod,
-                                        vvLODAsyncGLObject::DataPipeline *p)
+                                        vvLODAsyncGLObject::DataPipeline *p,
+                                        vvCancellationToken token)
 {
-  vtkTimerLog *log = nullptr;
-  if (m_benchmark)
+  const std::string &series =
+      m_dataPipelines[static_cast<size_t>(lod)].executeSeries;
+  vvTracer::Span span("DataPipeline::execute", "pipeline", series);
+  const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+  p->execute(token);
+
+  // Read by the GUI thread once the execution has been collected:
+  const double seconds = vvStatistics::elapsed(start);
+  m_dataPipelines[static_cast<size_t>(lod)].executeSeconds = seconds;
+  m_statistics->record(series, seconds);
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::backgroundExecute(
+    LevelOfDetail lod, DataPipeline *p, vvCancellationToken token,
+    vvStatistics::Clock::time_point submitted)
+{
+  m_statistics->record(
+        m_dataPipelines[static_cast<size_t>(lod)].queueWaitSeries,
+        vvStatistics::elapsed(submitted));
+
+  // The handler must be queued even if the pipeline throws, so that the
+  // exception is rethrown from monitor.get() on the GUI thread:
+  auto handler = [this, lod](const vvApplicationState &state)
     {
-    std::ostringstream out;
-    out << "Updating " << this->progressLabel() << " (" << lod << ").\n";
-    std::cerr << out.str();
+    this->completeUpdate(lod, state);
+    };
 
-    log = vtkTimerLog::New();
-    log->StartTimer();
+  // The estimate shown for the cookie counts from here, not from submission:
+  m_dataPipelines[static_cast<size_t>(lod)].cookie->start();
+
+  try
+    {
+    this->executeWrapper(lod, p, token);
+    }
+  catch (...)
+    {
+    m_completionQueue->push(this, handler);
+    throw;
     }
 
-  p->execute();
+  m_completionQueue->push(this, handler);
+}
 
-  if (log != nullptr)
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::completeUpdate(LevelOfDetail lodIndex,
+                                        const vvApplicationState &state)
+{
+  DataPipelineManager &lod = m_dataPipelines[static_cast<size_t>(lodIndex)];
+  assert("LOD is updating." && lod.status == LODStatus::Updating);
+
+  // Clean up first, get() rethrows errors from the background thread. A
+  // failed LOD is retried on the next sync:
+  assert("Cookie created." && lod.cookie != nullptr);
+  lod.dataPipeline->m_progressCookie = nullptr;
+  state.progress().removeEntry(lod.cookie);
+  lod.cookie = nullptr;
+  lod.status = LODStatus::OutOfDate;
+  dropPartialResult(lod);
+
+  // The handler is queued just before the task returns, so this may block very
+  // briefly:
+  lod.monitor.get();
+
+  // Cancelled results are discarded and relaunched in syncApplicationState:
+  if (!lod.token.cancelled())
     {
-    log->StopTimer();
-    std::ostringstream out;
-    out << this->progressLabel() << " (" << lod << ") ready! ("
-        << log->GetElapsedTime() << "s)\n";
-    std::cerr << out.str();
-    log->Delete();
+    updateExecutionEstimate(lod);
+    this->exportResult(lodIndex, lod);
+    lod.status = LODStatus::UpToDate;
     }
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::queuePartialResult(LevelOfDetail lodIndex)
+{
+  DataPipelineManager &lod = m_dataPipelines[static_cast<size_t>(lodIndex)];
+  if (!lod.partialResultQueued.exchange(true))
+    {
+    m_completionQueue->push(this,
+                            [this, lodIndex](const vvApplicationState &)
+                            { this->completePartialResult(lodIndex); });
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::completePartialResult(LevelOfDetail lodIndex)
+{
+  DataPipelineManager &lod = m_dataPipelines[static_cast<size_t>(lodIndex)];
+
+  // Clear the flag first, so publications made during the export are queued:
+  lod.partialResultQueued = false;
+
+  if (lod.status != LODStatus::Updating || lod.token.cancelled())
+    {
+    return;
+    }
+
+  if (lod.partialResult == nullptr)
+    {
+    lod.partialResult = this->createLODData(lodIndex);
+    assert("createLODData result valid." && lod.partialResult);
+    }
+  lod.dataPipeline->exportPartialResult(*lod.partialResult);
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::dropPartialResult(DataPipelineManager &lod)
+{
+  delete lod.partialResult;
+  lod.partialResult = nullptr;
+}
 
-  Vrui::requestUpdate();
+//------------------------------------------------------------------------------
+const vvLODAsyncGLObject::LODData *
+vvLODAsyncGLObject::renderableData(const DataPipelineManager &lod)
+{
+  switch (lod.status)
+    {
+    case LODStatus::UpToDate:
+      return lod.result;
+    case LODStatus::Updating:
+      return lod.partialResult;
+    default:
+      return nullptr;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -335,14 +884,78 @@ vvLODAsyncGLObject::DataPipelineManager::~DataPipelineManager()
   // Ensure background thread is finished:
   if (monitor.valid())
     {
+    token.cancel();
     monitor.wait();
     }
 
   delete dataPipeline;
   delete result;
+  delete partialResult;
   // Don't free cookie -- these are owned by vvProgress.
 }
 
+//------------------------------------------------------------------------------
+vvLODAsyncGLObject::ResultCache::~ResultCache()
+{
+  this->clear();
+}
+
+//------------------------------------------------------------------------------
+vvLODAsyncGLObject::LODData *
+vvLODAsyncGLObject::ResultCache::take(const std::string &key)
+{
+  for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+    if (it->first == key)
+      {
+      LODData *data = it->second;
+      stats.memorySize -= data->memorySize();
+      entries.erase(it);
+      stats.entries = entries.size();
+      return data;
+      }
+    }
+  return nullptr;
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::ResultCache::insert(const std::string &key,
+                                             LODData *data)
+{
+  entries.emplace_front(key, data);
+  stats.memorySize += data->memorySize();
+  stats.entries = entries.size();
+  this->trim();
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::ResultCache::trim()
+{
+  while (!entries.empty() &&
+         (entries.size() > maxEntries ||
+          (maxMemory > 0 && stats.memorySize > maxMemory)))
+    {
+    LODData *data = entries.back().second;
+    stats.memorySize -= data->memorySize();
+    delete data;
+    entries.pop_back();
+    ++stats.evictions;
+    }
+  stats.entries = entries.size();
+}
+
+//------------------------------------------------------------------------------
+void vvLODAsyncGLObject::ResultCache::clear()
+{
+  for (auto &entry : entries)
+    {
+    delete entry.second;
+    }
+  entries.clear();
+  stats.entries = 0;
+  stats.memorySize = 0;
+}
+
 //------------------------------------------------------------------------------
 vvLODAsyncGLObject::ObjectState::~ObjectState()
 {
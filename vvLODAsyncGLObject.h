@@ -1,14 +1,23 @@
 #ifndef VVLODASYNCGLOBJECT_H
 #define VVLODASYNCGLOBJECT_H
 
+#include "vvCancellationToken.h"
 #include "vvGLObject.h"
+#include "vvStatistics.h"
 
 #include <vtkNew.h>
 
-#include <array>
+#include <atomic>
+#include <functional>
 #include <future>
+#include <list>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
+class vvCompletionQueue;
+class vvMemoryManager;
 class vvProgressCookie;
 
 /**
@@ -31,7 +40,10 @@ public:
   using Superclass = vvGLObject;
 
   /**
-   * Enumerates the available levels of detail in order from best to fastest.
+   * Identifies a level of detail. Levels are numbered from best (0) to fastest
+   * (levelOfDetailCount() - 1). The named values describe the default
+   * three-level layout; objects that use more levels can refer to them with
+   * levelOfDetail(index).
    */
   enum class LevelOfDetail
     {
@@ -39,10 +51,14 @@ public:
     LoRes,
     Hint,
 
-    Count,
+    Count, /// Number of levels in the default layout.
     NoLOD = -1,
     };
 
+  /** Return the LevelOfDetail with the given index (0 is best). */
+  static LevelOfDetail levelOfDetail(std::size_t index)
+  { return static_cast<LevelOfDetail>(index); }
+
   /**
    * Subclass this to store internal data for this vvGLObject. Parameters
    * should be stored here so that they can be passed to the LOD pipelines
@@ -65,7 +81,18 @@ public:
    * and rendering pipelines. Typical VTK objects are best stored in a
    * vtkSmartPointer<vtkDataObject>.
    */
-  struct LODData { };
+  struct LODData
+  {
+    virtual ~LODData();
+
+    /**
+     * Approximate memory held by this object, in bytes. Used to enforce
+     * the result cache limits and the vvMemoryManager budget. VTK-backed
+     * subclasses can use vvMemoryManager::memorySize(). The default
+     * implementation returns 0.
+     */
+    virtual std::size_t memorySize() const;
+  };
 
   /**
    * Subclass this to implement a data pipeline for a single LOD.
@@ -85,12 +112,91 @@ public:
     virtual bool needsUpdate(const ObjectState &objState,
                              const LODData &result) const = 0;
 
-    /** Execute the data pipeline here. May execute asynchronously. */
-    virtual void execute() = 0;
+    /**
+     * Return a key that uniquely identifies the parameters applied by the last
+     * call to configure(), e.g. "iso=0.25;color=Pressure". Two results with the
+     * same key must be interchangeable. Used by the result cache (see
+     * vvLODAsyncGLObject::setResultCacheSize()), only when needsUpdate()
+     * returns true. The default implementation returns an empty string, which
+     * disables caching for this pipeline.
+     */
+    virtual std::string cacheKey() const;
+
+    /**
+     * Called when @a result is restored from the result cache in place of an
+     * execution, because its key matches cacheKey(). Pipelines whose
+     * needsUpdate() compares against the time of their last execution should
+     * record here that @a result is current, or it will be rejected and
+     * recomputed on the next frame. The default implementation does nothing.
+     */
+    virtual void adoptRestoredResult(const LODData &result);
+
+    /**
+     * Size of the input processed by the configuration applied in the last
+     * call to configure(), in arbitrary but consistent units (e.g. number of
+     * cells). Execution time estimates are scaled by it, see
+     * vvLODAsyncGLObject::estimatedExecutionTime(). This may be called while
+     * execute() is running, so it must only read state set by configure().
+     * The default implementation returns 1.
+     */
+    virtual double inputSize() const;
+
+    /**
+     * Execute the data pipeline here. May execute asynchronously. If @a token
+     * is cancelled, the result will be discarded and execution should stop
+     * as soon as possible. See vvCancellationToken::AbortObserver. Progress
+     * can be reported through progressCookie().
+     */
+    virtual void execute(const vvCancellationToken &token) = 0;
+
+    /**
+     * Return true if the result of the execution currently in progress is
+     * already obsolete for @a objState, i.e. needsUpdate() would be true once
+     * it is exported. When this returns true, the execution's token is
+     * cancelled and the pipeline is reconfigured and relaunched once it
+     * returns.
+     *
+     * This is called from the GUI thread while execute() is running, so it
+     * must only read state that was set by configure(). The default
+     * implementation returns false, which disables cancellation.
+     */
+    virtual bool isObsolete(const ObjectState &objState) const;
 
     /** Copy the data pipeline's outputs to @a result.
      */
     virtual void exportResult(LODData &result) const = 0;
+
+    /**
+     * Copy the partial output published by publishPartialResult() to
+     * @a result. This is called from the GUI thread while execute() continues
+     * on a worker thread, so implementations must synchronize with execute(),
+     * e.g. by copying completed blocks into a mutex-protected output. The
+     * default implementation does nothing.
+     */
+    virtual void exportPartialResult(LODData &result) const;
+
+  protected:
+    /**
+     * Call from execute() when a partial output (e.g. the completed blocks of
+     * a multiblock dataset) is ready to be shown. exportPartialResult() will
+     * be called from the GUI thread, and the partial result is rendered in
+     * place of lower LODs until execute() finishes. Repeated calls before the
+     * GUI thread picks up the partial result are coalesced. Does nothing for
+     * synchronous updates.
+     */
+    void publishPartialResult();
+
+    /**
+     * The vvProgress entry of the background update in progress, or nullptr
+     * for synchronous updates. execute() may report its progress through it,
+     * see vvProgressCookie::Observer.
+     */
+    vvProgressCookie* progressCookie() const { return m_progressCookie; }
+
+  private:
+    friend class vvLODAsyncGLObject;
+    std::function<void()> m_partialResultPublisher;
+    vvProgressCookie *m_progressCookie{nullptr};
   };
 
   /**
@@ -121,6 +227,15 @@ public:
      * turned off.
      */
     virtual void disable() = 0;
+
+    /**
+     * Called after disable() once the LOD's result has been evicted by the
+     * vvMemoryManager. Drop all references to the data passed to update(),
+     * e.g. by setting mapper inputs to nullptr, or the memory is not actually
+     * freed. update() is called again before the LOD is shown. The default
+     * implementation does nothing.
+     */
+    virtual void release();
   };
 
 public:
@@ -139,7 +254,95 @@ public:
                         const vvContextState &contextState,
                         GLContextData &contextData) const final;
 
-  /** Set true to print update timing information to stderr. @{ */
+  /**
+   * Scheduling priority of this object's background updates. LODs are always
+   * scheduled fastest-first across all objects; among pending LODs of the same
+   * level, objects with a higher priority are executed first. Default is 0.
+   * See vvThreadPool::Priority.
+   * @{
+   */
+  int priority() const { return m_priority; }
+  void setPriority(int priority) { m_priority = priority; }
+  /** @} */
+
+  /**
+   * Statistics for the result cache of a single LOD.
+   */
+  struct ResultCacheStatistics
+  {
+    std::size_t hits{0};
+    std::size_t misses{0};
+    std::size_t evictions{0};
+    std::size_t entries{0};
+    std::size_t memorySize{0};
+  };
+
+  /**
+   * Maximum number of previous results kept per LOD. When a pipeline needs to
+   * update and its DataPipeline::cacheKey() matches a cached result, that
+   * result is shown immediately instead of executing the pipeline. Least
+   * recently used results are evicted first. Cached results count toward the
+   * vvMemoryManager budget, which may release the cache of a LOD when over
+   * budget. Default is 0 (disabled).
+   * @{
+   */
+  std::size_t resultCacheSize() const { return m_resultCacheSize; }
+  void setResultCacheSize(std::size_t entries);
+  /** @} */
+
+  /**
+   * Maximum memory (as reported by LODData::memorySize()) held by the result
+   * cache of each LOD, in bytes. Default is 0 (unlimited).
+   * @{
+   */
+  std::size_t resultCacheMemoryLimit() const
+  { return m_resultCacheMemoryLimit; }
+  void setResultCacheMemoryLimit(std::size_t bytes);
+  /** @} */
+
+  /**
+   * The number of levels of detail, as returned by levelOfDetailCount() during
+   * init(). Zero before init().
+   */
+  std::size_t numberOfLevelsOfDetail() const { return m_dataPipelines.size(); }
+
+  /**
+   * Time from a parameter change (the first needsUpdate() that flagged it) to
+   * the first render of the matching @a lod result, in seconds. This is the
+   * "<prefix>/<LOD>/timeToVisible" series of vvApplicationState::statistics();
+   * use vvStatistics::histogram() for its distribution.
+   */
+  vvStatistics::Summary timeToVisible(LevelOfDetail lod) const;
+
+  /**
+   * Predicted execution time of @a lod with its current configuration in
+   * seconds, or a negative value if unknown. Predicted from an exponential
+   * moving average of the previous execution times of @a lod per unit of
+   * DataPipeline::inputSize().
+   */
+  double estimatedExecutionTime(LevelOfDetail lod) const;
+
+  /**
+   * Predicted seconds until the background update of @a lod completes, or a
+   * negative value if @a lod is not updating or the time is unknown. Refined
+   * by the progress reported through DataPipeline::progressCookie(). This can
+   * be used to e.g. stop waiting for HiRes when it is too far away. Also shown
+   * by vvProgress.
+   */
+  double estimatedTimeRemaining(LevelOfDetail lod) const;
+
+  /** Result cache statistics for @a lod. */
+  ResultCacheStatistics resultCacheStatistics(LevelOfDetail lod) const;
+
+  /**
+   * Prefix of this object's series in vvApplicationState::statistics(), e.g.
+   * "<prefix>/HiRes/execute". Derived from progressLabel() during init().
+   */
+  const std::string& statisticsPrefix() const { return m_statisticsPrefix; }
+
+  /**
+   * Set true to print this object's statistics to stderr when it is
+   * destroyed. @{ */
   bool benchmark() const { return m_benchmark; }
   void setBenchmark(bool benchmark) { m_benchmark = benchmark; }
   /** @} */
@@ -176,10 +379,27 @@ private: // vtkLODAsyncGLObject virtual API:
 
   /**
    * The string returned here will be used to label the background indicator.
-   * See vvProgress.
+   * It is read each time a background update starts, so it may reflect the
+   * current parameters. See vvProgress.
    */
   virtual std::string progressLabel() const = 0;
 
+  /**
+   * The number of levels of detail used by this object. Called once by init();
+   * the create*() methods below are then called with levels 0 (best) through
+   * levelOfDetailCount() - 1 (fastest). Levels that are not needed can be
+   * skipped by returning nullptr from createDataPipeline(). The default
+   * implementation returns LevelOfDetail::Count (HiRes, LoRes, and Hint).
+   */
+  virtual std::size_t levelOfDetailCount() const;
+
+  /**
+   * A short name for @a lod, used in progress labels and benchmark output. The
+   * default implementation returns "HiRes", "LoRes", and "Hint" for the
+   * default layout, and "LOD <index>" otherwise.
+   */
+  virtual std::string levelOfDetailName(LevelOfDetail lod) const;
+
   /**
    * Create and return an instance of an ObjectState subclass that will be
    * used to hold this vvLODAsyncGLObject's state.
@@ -205,17 +425,25 @@ private: // vtkLODAsyncGLObject virtual API:
    */
   virtual LODData* createLODData(LevelOfDetail lod) const = 0;
 
+  /**
+   * Return how relevant this object currently is on screen, e.g. its projected
+   * size or proximity to the view direction. Among pending LODs of the same
+   * level and priority(), more relevant objects are executed first. Evaluated
+   * when updates are launched. The default implementation returns 0.
+   */
+  virtual double screenRelevance(const vvApplicationState &appState) const;
+
 private: // Private nested classes, implementation  details, etc:
 
-  // These can be iterated over best->fast:
+  // The best LOD. The fastest is numberOfLevelsOfDetail() - 1.
   static constexpr LevelOfDetail BestDetail { LevelOfDetail::HiRes };
-  static constexpr LevelOfDetail FastDetail { LevelOfDetail::Hint };
 
   /**
-   * Used to store per-LOD state, just an array of length LevelOfDetail::Count.
+   * Used to store per-LOD state, indexed by LevelOfDetail. Sized to
+   * numberOfLevelsOfDetail() by init().
    */
   template <typename T>
-  using LODArray = std::array<T, static_cast<size_t>(LevelOfDetail::Count)>;
+  using LODArray = std::vector<T>;
 
   /**
    * The DataItem for vvLODAsyncGLObject. This should NOT be subclassed by
@@ -223,7 +451,9 @@ private: // Private nested classes, implementation  details, etc:
    */
   struct DataItem : public Superclass::DataItem
   {
-    DataItem() { renderPipelines.fill(nullptr); }
+    explicit DataItem(std::size_t numLODs)
+      : renderPipelines(numLODs, nullptr), releasedEvictions(numLODs, 0)
+    {}
     ~DataItem() override;
 
     RenderPipeline *renderPipeline(LevelOfDetail lod)
@@ -232,6 +462,8 @@ private: // Private nested classes, implementation  details, etc:
     }
 
     LODArray<RenderPipeline*> renderPipelines;
+    // DataPipelineManager::evictions when each pipeline was last released:
+    LODArray<unsigned int> releasedEvictions;
   };
 
   /**
@@ -245,6 +477,28 @@ private: // Private nested classes, implementation  details, etc:
     UpToDate /// Pipeline is up-to-date.
     };
 
+  /**
+   * LRU cache of previous results for a single LOD. Most recently used entries
+   * are at the front. Owns the cached LODData.
+   */
+  struct ResultCache
+  {
+    ~ResultCache();
+
+    /** Remove and return the entry for @a key, or nullptr if not cached. */
+    LODData* take(const std::string &key);
+
+    /** Add an entry, then evict entries until the limits are satisfied. */
+    void insert(const std::string &key, LODData *data);
+    void trim();
+    void clear();
+
+    std::list<std::pair<std::string, LODData*> > entries;
+    std::size_t maxEntries{0};
+    std::size_t maxMemory{0};
+    ResultCacheStatistics stats;
+  };
+
   /**
    * Contains data pipeline details for a single LOD.
    */
@@ -254,7 +508,35 @@ private: // Private nested classes, implementation  details, etc:
     LODStatus status{LODStatus::Invalid};
     DataPipeline *dataPipeline{nullptr};
     LODData *result{nullptr};
+    LODData *partialResult{nullptr}; // Valid while Updating, if published.
+    std::atomic<bool> partialResultQueued{false};
+    std::string resultKey; // Cache key of result, if any.
+    std::string pendingKey; // Cache key of the running execution.
+    // Statistics series names:
+    std::string queueWaitSeries;
+    std::string executeSeries;
+    std::string exportResultSeries;
+    std::string timeToVisibleSeries;
+    std::string progressLabel; // progressLabel() that progressText is from.
+    std::string progressText; // vvProgress label for updates.
+    // Moving average of execution seconds per unit of input:
+    vvStatistics::Estimator executionEstimate;
+    double executeInputSize{1.}; // inputSize() of the last execution.
+    double executeSeconds{0.}; // Duration of the last execution.
+    // When the current change was first flagged (epoch if not stale):
+    vvStatistics::Clock::time_point staleSince;
+    // When a later change was first seen while Updating (epoch if none). It
+    // becomes staleSince once the running update's result is ready:
+    vvStatistics::Clock::time_point changedWhileUpdating;
+    // staleSince of the current result until it is first rendered, as ticks
+    // since the clock epoch; zero once rendered. Read by syncContextState:
+    mutable std::atomic<vvStatistics::Clock::rep> pendingVisibleSince{0};
+    // Number of times the result was evicted. Render pipelines still holding
+    // the evicted data are released by syncContextState:
+    std::atomic<unsigned int> evictions{0};
+    ResultCache cache;
     std::future<void> monitor;
+    vvCancellationToken token;
     vvProgressCookie *cookie{nullptr};
   };
 
@@ -290,10 +572,103 @@ private: // Private methods:
   /** @} */
 
   /**
-   * Wrapper to call Vrui::requestUpdate after a pipeline finishes. Used for
-   * background updates.
+   * If the result cache holds the result for @a lod's current configuration,
+   * make it the live result and return true. Otherwise, remember the cache key
+   * for the upcoming execution and return false.
+   */
+  bool restoreCachedResult(LevelOfDetail lodIndex, DataPipelineManager &lod);
+
+  /**
+   * Fold the duration of @a lod's last (completed) execution into
+   * executionEstimate.
    */
-  void executeWrapper(LevelOfDetail lod, DataPipeline *pipeline);
+  static void updateExecutionEstimate(DataPipelineManager &lod);
+
+  /**
+   * Export the data pipeline output into @a lod's result. If the current
+   * result is cacheable, it is moved into the cache first.
+   */
+  void exportResult(LevelOfDetail lodIndex, DataPipelineManager &lod);
+
+  /**
+   * Timestamps used for the timeToVisible() metric. markStale() records when
+   * @a lod's parameters first changed; markResultReady() is called when the
+   * matching result is made live. Changes seen while @a lod is Updating are
+   * recorded in changedWhileUpdating and carried over by markResultReady(),
+   * since the result it makes live is already stale. @{
+   */
+  static void markStale(DataPipelineManager &lod);
+  static void markResultReady(DataPipelineManager &lod);
+  /** @} */
+
+  /**
+   * Report the size of @a lod's result to the vvMemoryManager.
+   */
+  void trackResult(LevelOfDetail lodIndex, DataPipelineManager &lod);
+
+  /**
+   * Report the size of @a lod's result cache to the vvMemoryManager. Must be
+   * called whenever the cache changes. The cache of each LOD is tracked as a
+   * single allocation, after the results in slot order.
+   */
+  void trackResultCache(LevelOfDetail lodIndex, DataPipelineManager &lod);
+
+  /**
+   * Release the result of @a lodIndex and mark it out-of-date. Called by the
+   * vvMemoryManager when over budget. Returns false if the result is live or
+   * about to be replaced by a running update. The render pipelines of the LOD
+   * are released by the next syncContextState() of each context.
+   */
+  bool evictResult(LevelOfDetail lodIndex);
+
+  /**
+   * Release the result cache of @a lodIndex. Called by the vvMemoryManager
+   * when over budget.
+   */
+  bool evictResultCache(LevelOfDetail lodIndex);
+
+  /**
+   * Wrapper around DataPipeline::execute that records its execution time.
+   */
+  void executeWrapper(LevelOfDetail lod, DataPipeline *pipeline,
+                      vvCancellationToken token);
+
+  /**
+   * Runs executeWrapper on a worker thread and queues completeUpdate on
+   * vvApplicationState::completionQueue() when it finishes.
+   */
+  void backgroundExecute(LevelOfDetail lod, DataPipeline *pipeline,
+                         vvCancellationToken token,
+                         vvStatistics::Clock::time_point submitted);
+
+  /**
+   * Collects a finished background update. Called from the GUI thread by
+   * vvCompletionQueue::drain().
+   */
+  void completeUpdate(LevelOfDetail lod, const vvApplicationState &state);
+
+  /**
+   * Queues completePartialResult for @a lod, unless it is already queued.
+   * Called from a worker thread by DataPipeline::publishPartialResult().
+   */
+  void queuePartialResult(LevelOfDetail lod);
+
+  /**
+   * Exports a published partial result of a running update. Called from the
+   * GUI thread by vvCompletionQueue::drain().
+   */
+  void completePartialResult(LevelOfDetail lod);
+
+  /**
+   * Delete @a lod's partial result, if any.
+   */
+  static void dropPartialResult(DataPipelineManager &lod);
+
+  /**
+   * Return the data that should be rendered for @a lod, or nullptr if it
+   * has nothing to show.
+   */
+  static const LODData* renderableData(const DataPipelineManager &lod);
 
 private: // Data members:
 
@@ -303,7 +678,24 @@ private: // Data members:
   // Data Pipelines and state:
   LODArray<DataPipelineManager> m_dataPipelines;
 
-  // Enable to print update benchmark timings.
+  // Scheduling priority relative to other objects:
+  int m_priority;
+
+  // Receives finished background updates:
+  vvCompletionQueue *m_completionQueue{nullptr};
+
+  // Tracks result sizes against the global memory budget:
+  vvMemoryManager *m_memoryManager{nullptr};
+
+  // Result cache limits:
+  std::size_t m_resultCacheSize{0};
+  std::size_t m_resultCacheMemoryLimit{0};
+
+  // Timing statistics:
+  vvStatistics *m_statistics{nullptr};
+  std::string m_statisticsPrefix;
+
+  // Enable to print statistics on destruction.
   bool m_benchmark;
 };
 
@@ -327,10 +719,13 @@ struct vvLODAsyncGLObject::LODIteratorImpl
     : m_skipInvalid(skip),
       m_direction(dir),
       m_managers(mgrs),
+      m_fast(static_cast<LevelOfDetail>(
+               static_cast<EnumIntType>(mgrs.size()) - 1)),
       m_current(m_direction == Direction::BestToFast ? m_best : m_fast)
   {
     // Find the first valid LOD:
-    if (m_skipInvalid && (*this)->status == LODStatus::Invalid)
+    if (m_skipInvalid && !this->isDone() &&
+        (*this)->status == LODStatus::Invalid)
       {
       this->next();
       }
@@ -340,7 +735,8 @@ struct vvLODAsyncGLObject::LODIteratorImpl
   void jumpToFast()
   {
     m_current = m_fast;
-    if (m_skipInvalid && (*this)->status == LODStatus::Invalid)
+    if (m_skipInvalid && !this->isDone() &&
+        (*this)->status == LODStatus::Invalid)
       {
       if (m_direction == Direction::BestToFast)
         {
@@ -357,7 +753,8 @@ struct vvLODAsyncGLObject::LODIteratorImpl
   void jumpToBest()
   {
     m_current = m_best;
-    if (m_skipInvalid && (*this)->status == LODStatus::Invalid)
+    if (m_skipInvalid && !this->isDone() &&
+        (*this)->status == LODStatus::Invalid)
       {
       if (m_direction == Direction::BestToFast)
         {
@@ -438,7 +835,8 @@ private:
       reinterpret_cast<EnumIntType&>(m_current) +=
           (m_direction == Direction::BestToFast ? +1 : -1);
       }
-    while (m_skipInvalid && (*this)->status == LODStatus::Invalid);
+    while (m_skipInvalid && !this->isDone() &&
+           (*this)->status == LODStatus::Invalid);
   }
 
   void prev()
@@ -448,15 +846,16 @@ private:
       reinterpret_cast<EnumIntType&>(m_current) +=
           (m_direction == Direction::BestToFast ? -1 : +1);
       }
-    while (m_skipInvalid && (*this)->status == LODStatus::Invalid);
+    while (m_skipInvalid && !this->isDone() &&
+           (*this)->status == LODStatus::Invalid);
   }
 
   const LevelOfDetail m_best{BestDetail};
-  const LevelOfDetail m_fast{FastDetail};
 
   bool m_skipInvalid;
   Direction m_direction;
   ManagerArrayType m_managers;
+  const LevelOfDetail m_fast;
   LevelOfDetail m_current;
 };
 
@@ -0,0 +1,202 @@
+#include "vvMappedFile.h"
+
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+#include <vtkDataArray.h>
+#include <vtkNew.h>
+#include <vtkVersionMacros.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// VTK 8.1 added user-defined free functions for array buffers:
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 1)
+#define VVMAPPEDFILE_USE_FREE_FUNCTION
+#endif
+
+namespace {
+
+#ifdef VVMAPPEDFILE_USE_FREE_FUNCTION
+
+// The free function of an array buffer only receives the buffer's address, so
+// the references to the mappings are kept here, keyed by address. Arrays that
+// start at the same address map the same file.
+struct MappingRegistry
+{
+  std::mutex mutex;
+  std::multimap<const void*, std::shared_ptr<vvMappedFile> > references;
+};
+
+MappingRegistry& mappingRegistry()
+{
+  // Never destroyed, as arrays may be freed during static destruction:
+  static MappingRegistry *registry = new MappingRegistry;
+  return *registry;
+}
+
+void releaseMapping(void *buffer)
+{
+  std::shared_ptr<vvMappedFile> mapping; // Unmapped after unlocking.
+  MappingRegistry &registry = mappingRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.references.find(buffer);
+  if (it != registry.references.end())
+    {
+    mapping.swap(it->second);
+    registry.references.erase(it);
+    }
+}
+
+#else // VVMAPPEDFILE_USE_FREE_FUNCTION
+
+// The arrays' DeleteEvent observers own a reference to the mapping, which is
+// released when the observer is destroyed along with its array:
+void releaseMapping(void *clientData)
+{
+  delete static_cast<std::shared_ptr<vvMappedFile>*>(clientData);
+}
+
+void ignoreEvent(vtkObject *, unsigned long, void *, void *)
+{
+}
+
+#endif // VVMAPPEDFILE_USE_FREE_FUNCTION
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+std::shared_ptr<vvMappedFile> vvMappedFile::open(const std::string &fileName)
+{
+  const int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+    std::cerr << "Cannot open " << fileName << ": " << std::strerror(errno)
+              << "\n";
+    return nullptr;
+    }
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0)
+    {
+    std::cerr << "Cannot stat " << fileName << ": " << std::strerror(errno)
+              << "\n";
+    ::close(fd);
+    return nullptr;
+    }
+
+  const std::size_t size = static_cast<std::size_t>(info.st_size);
+  char *data = nullptr;
+  if (size > 0)
+    {
+    // Private and writable, so VTK may modify the arrays (copy-on-write):
+    void *map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                       0);
+    if (map == MAP_FAILED)
+      {
+      std::cerr << "Cannot map " << fileName << ": " << std::strerror(errno)
+                << "\n";
+      ::close(fd);
+      return nullptr;
+      }
+    data = static_cast<char*>(map);
+    }
+
+  // The mapping stays valid after the descriptor is closed:
+  ::close(fd);
+
+  return std::shared_ptr<vvMappedFile>(new vvMappedFile(fileName, data, size));
+}
+
+//------------------------------------------------------------------------------
+vvMappedFile::vvMappedFile(const std::string &fileName, char *data,
+                           std::size_t size)
+  : m_fileName(fileName),
+    m_data(data),
+    m_size(size)
+{
+}
+
+//------------------------------------------------------------------------------
+vvMappedFile::~vvMappedFile()
+{
+  if (m_data)
+    {
+    ::munmap(m_data, m_size);
+    }
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkDataArray>
+vvMappedFile::createArray(int vtkType, std::size_t offset, vtkIdType numTuples,
+                          int numComponents)
+{
+  vtkSmartPointer<vtkDataArray> array;
+  array.TakeReference(vtkDataArray::CreateDataArray(vtkType));
+  if (!array || numTuples < 0 || numComponents < 1)
+    {
+    return vtkSmartPointer<vtkDataArray>();
+    }
+
+  const std::size_t valueSize =
+      static_cast<std::size_t>(array->GetDataTypeSize());
+  const std::size_t numValues =
+      static_cast<std::size_t>(numTuples) * numComponents;
+  if (offset % valueSize != 0 || offset > m_size ||
+      numValues > (m_size - offset) / valueSize)
+    {
+    return vtkSmartPointer<vtkDataArray>();
+    }
+
+  array->SetNumberOfComponents(numComponents);
+  char *buffer = m_data + offset;
+
+#ifdef VVMAPPEDFILE_USE_FREE_FUNCTION
+  // The reference to the mapping follows the array's buffer, which is shared
+  // by shallow copies, and is released by the buffer's free function:
+  {
+  MappingRegistry &registry = mappingRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.references.emplace(buffer, this->shared_from_this());
+  }
+  array->SetVoidArray(buffer, static_cast<vtkIdType>(numValues), 0,
+                      vtkDataArray::VTK_DATA_ARRAY_USER_DEFINED);
+  array->SetArrayFreeFunction(&releaseMapping);
+#else
+  // save = 1: The array must not free the mapped memory. Without buffer free
+  // functions, the array itself keeps the mapping alive:
+  array->SetVoidArray(buffer, static_cast<vtkIdType>(numValues), 1);
+
+  vtkNew<vtkCallbackCommand> keepAlive;
+  keepAlive->SetCallback(&ignoreEvent);
+  keepAlive->SetClientData(
+        new std::shared_ptr<vvMappedFile>(this->shared_from_this()));
+  keepAlive->SetClientDataDeleteCallback(&releaseMapping);
+  array->AddObserver(vtkCommand::DeleteEvent, keepAlive.Get());
+#endif
+
+  return array;
+}
+
+//------------------------------------------------------------------------------
+void vvMappedFile::prefetch(std::size_t offset, std::size_t length) const
+{
+  if (!m_data || offset >= m_size)
+    {
+    return;
+    }
+
+  // madvise requires a page-aligned address:
+  const std::size_t pageSize =
+      static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  const std::size_t begin = offset - offset % pageSize;
+  const std::size_t end = length < m_size - offset ? offset + length : m_size;
+  ::madvise(m_data + begin, end - begin, MADV_WILLNEED);
+}
@@ -0,0 +1,92 @@
+#ifndef VVMAPPEDFILE_H
+#define VVMAPPEDFILE_H
+
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+class vtkDataArray;
+
+/**
+ * @brief The vvMappedFile class maps a file into memory so that raw array
+ * payloads can be used as vtkDataArrays without copying them to the heap.
+ *
+ * Pages are read by the OS on first access, so loading a large file is nearly
+ * instant and only the parts that are actually used occupy memory. The mapping
+ * is private: writes to the arrays (e.g. by in-place filters) are copy-on-write
+ * and never reach the file.
+ *
+ * Arrays created with createArray() keep the mapping alive until their
+ * storage is released, including by shallow copies that share it (with VTK
+ * older than 8.1, only until the array itself is destroyed). vvReader
+ * subclasses use it when vvReader::memoryMapped() is set:
+ *
+ * @code
+ * void MyReader::executeReaderData(const vvCancellationToken &)
+ * {
+ *   std::shared_ptr<vvMappedFile> file = vvMappedFile::open(m_fileName);
+ *   if (file)
+ *     {
+ *     m_image->GetPointData()->SetScalars(file->createArray(
+ *           VTK_FLOAT, m_headerSize, m_dims[0] * m_dims[1] * m_dims[2]));
+ *     }
+ * }
+ * @endcode
+ *
+ * The payload must be in native byte order, and offsets must be aligned to the
+ * size of the array's value type. The file must not be truncated while it is
+ * mapped. POSIX only.
+ */
+class vvMappedFile : public std::enable_shared_from_this<vvMappedFile>
+{
+public:
+  /**
+   * Map @a fileName read-only. Returns nullptr and prints a diagnostic to
+   * std::cerr if the file cannot be opened or mapped.
+   */
+  static std::shared_ptr<vvMappedFile> open(const std::string &fileName);
+
+  ~vvMappedFile();
+
+  const std::string& fileName() const { return m_fileName; }
+
+  /** Size of the file in bytes. */
+  std::size_t size() const { return m_size; }
+
+  /** The mapped contents of the file. nullptr for empty files. */
+  const char* data() const { return m_data; }
+
+  /**
+   * Create an array of VTK type @a vtkType (e.g. VTK_FLOAT) that uses
+   * @a numTuples * @a numComponents values starting at byte @a offset of the
+   * file as its storage. Returns nullptr if the range does not fit in the file
+   * or @a offset is misaligned.
+   */
+  vtkSmartPointer<vtkDataArray> createArray(int vtkType, std::size_t offset,
+                                            vtkIdType numTuples,
+                                            int numComponents = 1);
+
+  /**
+   * Ask the OS to start reading @a length bytes at @a offset in the
+   * background. Pages are otherwise read on first access, which may be on the
+   * GUI thread while rendering. Returns immediately.
+   */
+  void prefetch(std::size_t offset = 0,
+                std::size_t length = static_cast<std::size_t>(-1)) const;
+
+private:
+  vvMappedFile(const std::string &fileName, char *data, std::size_t size);
+
+  // Not implemented:
+  vvMappedFile(const vvMappedFile&);
+  vvMappedFile& operator=(const vvMappedFile&);
+
+  std::string m_fileName;
+  char *m_data;
+  std::size_t m_size;
+};
+
+#endif // VVMAPPEDFILE_H
@@ -0,0 +1,125 @@
+#include "vvMemoryManager.h"
+
+#include <vtkDataObject.h>
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+vvMemoryManager::vvMemoryManager()
+  : m_budget(0),
+    m_total(0),
+    m_evictions(0),
+    m_clock(0)
+{
+}
+
+//------------------------------------------------------------------------------
+vvMemoryManager::~vvMemoryManager()
+{
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvMemoryManager::memorySize(vtkDataObject *object)
+{
+  // GetActualMemorySize reports kibibytes:
+  return object ? static_cast<std::size_t>(object->GetActualMemorySize()) * 1024
+                : 0;
+}
+
+//------------------------------------------------------------------------------
+void vvMemoryManager::track(const void *owner, unsigned int slot,
+                            std::size_t bytes, Evictor evictor)
+{
+  Entry &entry = m_entries[Key(owner, slot)];
+  Statistics &stats = m_statistics[owner];
+
+  // Replace the previous size, if any (new entries start at zero):
+  m_total -= entry.bytes;
+  stats.memorySize -= entry.bytes;
+
+  entry.bytes = bytes;
+  entry.lastUse = ++m_clock;
+  entry.evictor = std::move(evictor);
+
+  m_total += bytes;
+  stats.memorySize += bytes;
+}
+
+//------------------------------------------------------------------------------
+void vvMemoryManager::untrack(const void *owner, unsigned int slot)
+{
+  auto it = m_entries.find(Key(owner, slot));
+  if (it != m_entries.end())
+    {
+    m_total -= it->second.bytes;
+    m_statistics[owner].memorySize -= it->second.bytes;
+    m_entries.erase(it);
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvMemoryManager::untrackAll(const void *owner)
+{
+  auto it = m_entries.lower_bound(Key(owner, 0));
+  while (it != m_entries.end() && it->first.first == owner)
+    {
+    m_total -= it->second.bytes;
+    it = m_entries.erase(it);
+    }
+  m_statistics.erase(owner);
+}
+
+//------------------------------------------------------------------------------
+void vvMemoryManager::enforce()
+{
+  if (m_budget == 0 || m_total <= m_budget)
+    {
+    return;
+    }
+
+  // Collect candidates, least recently used first. The vector is kept to
+  // avoid allocating every frame while over budget:
+  m_candidates.clear();
+  for (const auto &entry : m_entries)
+    {
+    if (entry.second.bytes > 0)
+      {
+      m_candidates.emplace_back(entry.second.lastUse, entry.first);
+      }
+    }
+  std::sort(m_candidates.begin(), m_candidates.end());
+
+  for (const auto &candidate : m_candidates)
+    {
+    if (m_total <= m_budget)
+      {
+      break;
+      }
+
+    auto it = m_entries.find(candidate.second);
+    if (it == m_entries.end() || !it->second.evictor)
+      {
+      continue;
+      }
+
+    // Copy the evictor: it will typically untrack (and destroy) the entry.
+    const std::size_t bytes = it->second.bytes;
+    Evictor evictor = it->second.evictor;
+    if (evictor())
+      {
+      this->untrack(candidate.second.first, candidate.second.second);
+      Statistics &stats = m_statistics[candidate.second.first];
+      ++stats.evictions;
+      stats.evictedSize += bytes;
+      ++m_evictions;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+vvMemoryManager::Statistics
+vvMemoryManager::statistics(const void *owner) const
+{
+  auto it = m_statistics.find(owner);
+  return it != m_statistics.end() ? it->second : Statistics();
+}
@@ -0,0 +1,120 @@
+#ifndef VVMEMORYMANAGER_H
+#define VVMEMORYMANAGER_H
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+class vtkDataObject;
+
+/**
+ * @brief The vvMemoryManager class enforces a process-wide memory budget for
+ * cached pipeline results.
+ *
+ * Owners (e.g. vvLODAsyncGLObject) report the size of each of their
+ * allocations with track(), together with an Evictor callback that releases
+ * the allocation. Once per frame, vvApplicationState calls enforce(), which
+ * evicts allocations, least recently tracked first, until the total is within
+ * budget(). An evictor may refuse (return false) if its allocation is currently
+ * in use, e.g. because it is being rendered.
+ *
+ * This class is not thread-safe; it should only be used from the GUI thread.
+ */
+class vvMemoryManager
+{
+public:
+  /**
+   * Release an allocation. Return false if the allocation cannot be released
+   * right now.
+   */
+  using Evictor = std::function<bool()>;
+
+  /**
+   * Memory statistics for a single owner, in bytes.
+   */
+  struct Statistics
+  {
+    /** Currently tracked memory. */
+    std::size_t memorySize{0};
+    /** Number of allocations released by enforce(). */
+    std::size_t evictions{0};
+    /** Total memory released by enforce(). */
+    std::size_t evictedSize{0};
+  };
+
+  vvMemoryManager();
+  ~vvMemoryManager();
+
+  /**
+   * Return the memory used by @a object in bytes, using
+   * vtkDataObject::GetActualMemorySize(). Returns 0 for nullptr.
+   */
+  static std::size_t memorySize(vtkDataObject *object);
+
+  /**
+   * Memory budget in bytes. Zero (default) means unlimited.
+   * @{
+   */
+  std::size_t budget() const { return m_budget; }
+  void setBudget(std::size_t bytes) { m_budget = bytes; }
+  /** @} */
+
+  /** Total tracked memory in bytes. */
+  std::size_t totalMemorySize() const { return m_total; }
+
+  /**
+   * Record that allocation @a slot of @a owner holds @a bytes, releasable by
+   * @a evictor. Marks the allocation as most recently used.
+   */
+  void track(const void *owner, unsigned int slot, std::size_t bytes,
+             Evictor evictor);
+
+  /**
+   * Stop tracking allocation @a slot of @a owner.
+   */
+  void untrack(const void *owner, unsigned int slot);
+
+  /**
+   * Stop tracking all allocations of @a owner and drop its statistics. Must be
+   * called before @a owner is destroyed.
+   */
+  void untrackAll(const void *owner);
+
+  /**
+   * Evict allocations until totalMemorySize() is within budget(), or no
+   * further allocations can be evicted.
+   */
+  void enforce();
+
+  /** Statistics for @a owner. */
+  Statistics statistics(const void *owner) const;
+
+  /** Number of allocations released by enforce() across all owners. */
+  std::size_t evictions() const { return m_evictions; }
+
+private:
+  // Not implemented:
+  vvMemoryManager(const vvMemoryManager&);
+  vvMemoryManager& operator=(const vvMemoryManager&);
+
+  using Key = std::pair<const void*, unsigned int>;
+
+  struct Entry
+  {
+    std::size_t bytes;
+    unsigned long long lastUse;
+    Evictor evictor;
+  };
+
+  std::map<Key, Entry> m_entries;
+  std::vector<std::pair<unsigned long long, Key> > m_candidates; // Reused
+  std::map<const void*, Statistics> m_statistics;
+  std::size_t m_budget;
+  std::size_t m_total;
+  std::size_t m_evictions;
+  unsigned long long m_clock;
+};
+
+#endif // VVMEMORYMANAGER_H
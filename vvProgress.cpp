@@ -13,11 +13,13 @@
 
 #include <algorithm>
 #include <cassert>
-#include <set>
-#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
 
 //------------------------------------------------------------------------------
 vvProgress::DataItem::DataItem()
+  : textRevision(0)
 {
   actor->SetTextScaleModeToViewport();
   vtkCoordinate *coord = actor->GetPositionCoordinate();
@@ -32,7 +34,9 @@ vvProgress::DataItem::~DataItem()
 
 //------------------------------------------------------------------------------
 vvProgress::vvProgress()
-  : m_visible(true)
+  : m_visible(true),
+    m_dirty(true),
+    m_textRevision(0)
 {
   m_tprop->SetJustificationToRight();
   m_tprop->SetVerticalJustificationToTop();
@@ -62,7 +66,9 @@ vvProgress::~vvProgress()
 vvProgressCookie *vvProgress::addEntry(std::string text)
 {
   vvProgressCookie *cookie = new vvProgressCookie(text);
+  cookie->m_owner = this;
   m_entries.push_back(cookie);
+  m_dirty = true;
   return cookie;
 }
 
@@ -73,6 +79,7 @@ void vvProgress::removeEntry(vvProgressCookie *cookie)
   assert("Double free detected." && newEnd < m_entries.end());
   m_entries.resize(std::distance(m_entries.begin(), newEnd));
   delete cookie;
+  m_dirty = true;
 }
 
 //------------------------------------------------------------------------------
@@ -96,21 +103,88 @@ void vvProgress::syncApplicationState(const vvApplicationState &state)
 {
   this->Superclass::syncApplicationState(state);
 
-  if (m_entries.empty())
+  this->pollEntries();
+  if (!m_dirty)
     {
-    m_text.clear();
     return;
     }
+  m_dirty = false;
 
-  std::ostringstream str;
-  str << "Update(s) in progress:\n";
+  // Rebuild in place to reuse the string's storage:
+  m_text.clear();
+  if (!m_entries.empty())
+    {
+    m_text += "Update(s) in progress:";
+    for (const auto cookie : m_entries)
+      {
+      m_text += "\n  - ";
+      m_text += cookie->text();
+      if (cookie->m_shownQueued)
+        {
+        m_text += " (queued)";
+        continue;
+        }
+      if (cookie->m_shownStage)
+        {
+        m_text += ": ";
+        m_text += cookie->m_shownStage;
+        }
+      if (cookie->m_shownPercent >= 0)
+        {
+        char percent[8];
+        std::snprintf(percent, sizeof(percent), " %d%%",
+                      cookie->m_shownPercent);
+        m_text += percent;
+        }
+      if (cookie->m_shownRemaining >= 0)
+        {
+        char remaining[24];
+        if (cookie->m_shownRemaining < 120)
+          {
+          std::snprintf(remaining, sizeof(remaining), ", ~%d s left",
+                        cookie->m_shownRemaining);
+          }
+        else
+          {
+          std::snprintf(remaining, sizeof(remaining), ", ~%d min left",
+                        cookie->m_shownRemaining / 60);
+          }
+        m_text += remaining;
+        }
+      }
+    }
+  ++m_textRevision;
+}
+
+//------------------------------------------------------------------------------
+void vvProgress::pollEntries()
+{
+  // Only whole percents and seconds are shown, so finer updates don't rebuild
+  // the text:
   for (const auto cookie : m_entries)
     {
-    str << "  - " << cookie->text() << "\n";
+    const bool queued = !cookie->started();
+    const double fraction = cookie->fraction();
+    const int percent = fraction < 0. ? -1 : static_cast<int>(
+          100. * std::min(fraction, 1.));
+    const char *stage = cookie->stage();
+
+    // Whole seconds, or whole minutes (in seconds) for long waits:
+    const double eta = cookie->estimatedTimeRemaining();
+    const int remaining = eta < 0. ? -1 : eta < 119. ?
+          static_cast<int>(std::ceil(eta)) :
+          60 * static_cast<int>(std::ceil(eta / 60.));
+
+    if (queued != cookie->m_shownQueued || percent != cookie->m_shownPercent ||
+        stage != cookie->m_shownStage || remaining != cookie->m_shownRemaining)
+      {
+      cookie->m_shownQueued = queued;
+      cookie->m_shownPercent = percent;
+      cookie->m_shownStage = stage;
+      cookie->m_shownRemaining = remaining;
+      m_dirty = true;
+      }
     }
-  m_text = str.str();
-  // Pop off the last newline:
-  m_text.pop_back();
 }
 
 //------------------------------------------------------------------------------
@@ -129,7 +203,11 @@ void vvProgress::syncContextState(const vvApplicationState &appState,
     return;
     }
 
-  dataItem->actor->SetInput(m_text.c_str());
+  if (dataItem->textRevision != m_textRevision)
+    {
+    dataItem->actor->SetInput(m_text.c_str());
+    dataItem->textRevision = m_textRevision;
+    }
   dataItem->actor->SetVisibility(1);
 }
 
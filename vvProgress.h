@@ -24,8 +24,12 @@ class vtkTextProperty;
  * is used to update the notification text and remove the notification. The
  * notification is removed by passing the cookie back to removeEntry.
  *
- * Note that vvProgressCookie is not thread-safe, and any updates to it should
- * be performed from the GUI thread.
+ * Background processes may also report the fraction of work completed and
+ * the current stage name through the cookie from their worker thread (see
+ * vvProgressCookie::setFraction() and vvProgressCookie::Observer). These are
+ * polled once per frame and shown after the text together with the
+ * estimated time remaining, e.g. "Updating Contours (HiRes) 43%, ~12 s left".
+ * All other cookie updates must be performed from the GUI thread.
  */
 class vvProgress : public vvGLObject
 {
@@ -38,6 +42,7 @@ public:
     ~DataItem();
 
     vtkNew<vtkTextActor> actor;
+    unsigned long textRevision; // m_textRevision of the actor's input.
   };
 
   vvProgress();
@@ -58,15 +63,32 @@ public:
    */
   void removeEntry(vvProgressCookie *cookie);
 
+  /** The number of entries that have not been removed. */
+  std::size_t numberOfEntries() const { return m_entries.size(); }
+
   virtual void initVvContext(vvContextState &vvContext,
                              GLContextData &contextData) const;
   virtual void syncApplicationState(const vvApplicationState &state);
+  virtual bool deferrable() const { return false; }
   virtual void syncContextState(const vvApplicationState &appState,
                                 const vvContextState &contextState,
                                 GLContextData &contextData) const;
 
 private:
+  friend class vvProgressCookie;
+
+  /** Schedule the notification text to be rebuilt. */
+  void entriesModified() { m_dirty = true; }
+
+  /** Mark the text dirty if any entry's displayed progress has changed. */
+  void pollEntries();
+
   bool m_visible;
+
+  // The notification text is only rebuilt when the entries change, and only
+  // passed to the actors when the revision changes:
+  bool m_dirty;
+  unsigned long m_textRevision;
   std::string m_text;
   vtkNew<vtkTextProperty> m_tprop;
   std::vector<vvProgressCookie*> m_entries;
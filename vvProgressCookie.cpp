@@ -1,8 +1,25 @@
 #include "vvProgressCookie.h"
 
+#include <vtkAlgorithm.h>
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+
+#include "vvProgress.h"
+
+#include <algorithm>
+
 //------------------------------------------------------------------------------
 vvProgressCookie::vvProgressCookie(std::string text)
-  : m_text(text)
+  : m_text(text),
+    m_owner(nullptr),
+    m_fraction(-1.),
+    m_stage(nullptr),
+    m_startTicks(0),
+    m_estimatedDuration(-1.),
+    m_shownQueued(true),
+    m_shownPercent(-1),
+    m_shownStage(nullptr),
+    m_shownRemaining(-1)
 {
 }
 
@@ -10,3 +27,109 @@ vvProgressCookie::vvProgressCookie(std::string text)
 vvProgressCookie::~vvProgressCookie()
 {
 }
+
+//------------------------------------------------------------------------------
+void vvProgressCookie::setText(std::string text)
+{
+  if (text != m_text)
+    {
+    m_text.swap(text);
+    if (m_owner)
+      {
+      m_owner->entriesModified();
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvProgressCookie::start()
+{
+  // Ticks are never 0 in practice, as steady_clock counts from boot or later:
+  std::chrono::steady_clock::rep expected = 0;
+  m_startTicks.compare_exchange_strong(
+        expected, std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+//------------------------------------------------------------------------------
+double vvProgressCookie::elapsedTime() const
+{
+  const std::chrono::steady_clock::rep startTicks = m_startTicks.load();
+  if (startTicks == 0)
+    {
+    return 0.;
+    }
+  const std::chrono::steady_clock::duration elapsed =
+      std::chrono::steady_clock::now().time_since_epoch() -
+      std::chrono::steady_clock::duration(startTicks);
+  return std::chrono::duration<double>(elapsed).count();
+}
+
+//------------------------------------------------------------------------------
+double vvProgressCookie::estimatedTimeRemaining() const
+{
+  if (!this->started())
+    {
+    return -1.;
+    }
+
+  const double elapsed = this->elapsedTime();
+  const double fraction = this->fraction();
+  if (fraction >= 0.1)
+    {
+    return elapsed * (1. - std::min(fraction, 1.)) / fraction;
+    }
+  if (m_estimatedDuration >= 0.)
+    {
+    return std::max(m_estimatedDuration - elapsed, 0.);
+    }
+  return -1.;
+}
+
+//------------------------------------------------------------------------------
+vvProgressCookie::Observer::Observer(vvProgressCookie *cookie,
+                                     vtkAlgorithm *algorithm,
+                                     const char *stage, double begin,
+                                     double end)
+  : m_cookie(cookie),
+    m_begin(begin),
+    m_end(end),
+    m_algorithm(algorithm),
+    m_observerId(0)
+{
+  if (!m_cookie)
+    {
+    return;
+    }
+
+  if (stage)
+    {
+    m_cookie->setStage(stage);
+    }
+  m_cookie->setFraction(m_begin);
+
+  m_command = vtkSmartPointer<vtkCallbackCommand>::New();
+  m_command->SetCallback(&forwardProgress);
+  m_command->SetClientData(this);
+  m_observerId = m_algorithm->AddObserver(vtkCommand::ProgressEvent,
+                                          m_command.Get());
+}
+
+//------------------------------------------------------------------------------
+vvProgressCookie::Observer::~Observer()
+{
+  if (m_command)
+    {
+    m_algorithm->RemoveObserver(m_observerId);
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvProgressCookie::Observer::forwardProgress(vtkObject *, unsigned long,
+                                                 void *clientData,
+                                                 void *callData)
+{
+  const Observer *self = static_cast<const Observer*>(clientData);
+  const double progress = *static_cast<const double*>(callData);
+  self->m_cookie->setFraction(self->m_begin +
+                              progress * (self->m_end - self->m_begin));
+}
@@ -1,19 +1,91 @@
 #ifndef VVPROGRESSCOOKIE_H
 #define VVPROGRESSCOOKIE_H
 
-#include <array>
+#include <vtkSmartPointer.h>
+
+#include <atomic>
+#include <chrono>
 #include <string>
 
+class vtkAlgorithm;
+class vtkCallbackCommand;
+class vtkObject;
 class vvProgress;
 
 /**
  * @brief The vvProgressCookie class is used to manage vvProgress notifications.
+ *
+ * The text and the estimated duration may only be changed from the GUI thread.
+ * The start, fraction, and stage are lock-free and may be updated from the
+ * worker thread that performs the update; vvProgress picks them up once per
+ * frame. Until start() is called, the entry is shown as queued.
+ * VTK algorithms can report their progress through an Observer:
+ *
+ * @code
+ * void MyPipeline::execute(const vvCancellationToken &token)
+ * {
+ *   vvProgressCookie::Observer progress(this->progressCookie(),
+ *                                       m_contour.Get(), "Contouring");
+ *   m_contour->Update();
+ * }
+ * @endcode
  */
 class vvProgressCookie
 {
 public:
-  std::string text() const { return m_text; }
-  void setText(std::string text) { m_text = text; }
+  class Observer;
+
+  const std::string& text() const { return m_text; }
+  void setText(std::string text);
+
+  /**
+   * Fraction of the work completed in [0, 1], or a negative value if unknown
+   * (the default). Thread-safe.
+   * @{
+   */
+  double fraction() const { return m_fraction.load(); }
+  void setFraction(double fraction) { m_fraction.store(fraction); }
+  /** @} */
+
+  /**
+   * Optional name of the current stage of the work, e.g. "Contouring", or
+   * nullptr (the default). The string must have static storage duration, such
+   * as a string literal. Thread-safe.
+   * @{
+   */
+  const char* stage() const { return m_stage.load(); }
+  void setStage(const char *stage) { m_stage.store(stage); }
+  /** @} */
+
+  /**
+   * Mark the start of the work, i.e. the end of its wait in the thread pool.
+   * Called by the worker thread; only the first call counts. Thread-safe.
+   */
+  void start();
+
+  /** True once start() has been called. Thread-safe. */
+  bool started() const { return m_startTicks.load() != 0; }
+
+  /**
+   * Predicted duration of the work in seconds, excluding the wait before
+   * start(), or a negative value if unknown (the default). Set by the owner
+   * of the cookie when the work is launched.
+   * @{
+   */
+  double estimatedDuration() const { return m_estimatedDuration; }
+  void setEstimatedDuration(double seconds) { m_estimatedDuration = seconds; }
+  /** @} */
+
+  /** Seconds since start(), or 0 if the work has not started. */
+  double elapsedTime() const;
+
+  /**
+   * Predicted seconds until the work completes, or a negative value if
+   * unknown or not started. Extrapolated from fraction() once at least 10% is
+   * reported, otherwise derived from estimatedDuration(). An overdue estimate
+   * yields 0.
+   */
+  double estimatedTimeRemaining() const;
 
 protected:
   friend class vvProgress;
@@ -23,6 +95,53 @@ protected:
 
 private:
   std::string m_text;
+  vvProgress *m_owner; // Notified when the text changes.
+
+  std::atomic<double> m_fraction;
+  std::atomic<const char*> m_stage;
+  // steady_clock ticks at start(), or 0 if not started:
+  std::atomic<std::chrono::steady_clock::rep> m_startTicks;
+  double m_estimatedDuration;
+
+  // Last values shown by m_owner, only used from the GUI thread:
+  bool m_shownQueued;
+  int m_shownPercent;
+  const char *m_shownStage;
+  int m_shownRemaining; // Seconds, rounded for display.
+
+};
+
+/**
+ * @brief Forwards vtkCommand::ProgressEvent from an algorithm to a cookie
+ * while the observer exists.
+ *
+ * The algorithm's progress is mapped to [@a begin, @a end] of the cookie's
+ * fraction, so that a pipeline of several algorithms can report its overall
+ * progress. If @a stage is not nullptr, the cookie's stage is set on
+ * construction. A nullptr @a cookie (e.g. for synchronous updates) is allowed,
+ * in which case nothing is reported.
+ */
+class vvProgressCookie::Observer
+{
+public:
+  Observer(vvProgressCookie *cookie, vtkAlgorithm *algorithm,
+           const char *stage = nullptr, double begin = 0., double end = 1.);
+  ~Observer();
+
+private:
+  // Not implemented:
+  Observer(const Observer&);
+  Observer& operator=(const Observer&);
+
+  static void forwardProgress(vtkObject *caller, unsigned long eventId,
+                              void *clientData, void *callData);
+
+  vvProgressCookie *m_cookie;
+  double m_begin;
+  double m_end;
+  vtkSmartPointer<vtkAlgorithm> m_algorithm;
+  vtkSmartPointer<vtkCallbackCommand> m_command;
+  unsigned long m_observerId;
 };
 
 #endif // VVPROGRESSCOOKIE_H
@@ -1,22 +1,93 @@
 #include "vvReader.h"
 
 #include <vtkDataObject.h>
-#include <vtkTimerLog.h>
-
-#include <Vrui/Vrui.h>
+#include <vtkMultiBlockDataSet.h>
 
 #include "vvApplicationState.h"
+#include "vvCompletionQueue.h"
+#include "vvDiskCache.h"
+#include "vvMemoryManager.h"
 #include "vvProgress.h"
+#include "vvProgressCookie.h"
+#include "vvThreadPool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <iostream>
-#include <sstream>
+#include <mutex>
+#include <utility>
+
+//------------------------------------------------------------------------------
+struct vvReader::PieceRead
+{
+  PieceRead(std::size_t numPieces, const vvCancellationToken &token_,
+            vvStatistics::Clock::time_point submitted_,
+            std::shared_ptr<Stream> stream_)
+    : pieces(numPieces),
+      remaining(numPieces),
+      token(token_),
+      submitted(submitted_),
+      stream(std::move(stream_))
+  {
+  }
+
+  std::vector<vtkSmartPointer<vtkDataObject> > pieces;
+  std::atomic<std::size_t> remaining;
+  vvCancellationToken token;
+  vvStatistics::Clock::time_point submitted;
+  std::shared_ptr<Stream> stream; // Streaming reduction of the read, if any.
+  std::once_flag started;
+  vvStatistics::Clock::time_point start; // When the first piece started.
+  std::mutex errorMutex;
+  std::exception_ptr error; // The first exception thrown by any piece.
+  std::promise<void> done;
+};
+
+//------------------------------------------------------------------------------
+struct vvReader::Stream
+{
+  Stream(const vvCancellationToken &token_, vvProgressCookie *cookie_)
+    : token(token_),
+      cookie(cookie_),
+      start(vvStatistics::Clock::now())
+  {
+  }
+
+  vvCancellationToken token;
+  vvProgressCookie *cookie; // Started along with the read.
+  vvStatistics::Clock::time_point start;
+  bool firstSnapshot{true}; // Only used by the consumer.
+  std::exception_ptr error; // First exception from reduceChunk().
+
+  std::mutex mutex; // Protects the members below.
+  std::deque<vtkSmartPointer<vtkDataObject> > chunks;
+  bool consumerActive{false};
+  bool inputEnded{false};
+
+  std::promise<void> done;
+};
 
 //------------------------------------------------------------------------------
 vvReader::vvReader()
   : m_benchmark(false),
+    m_memoryMapped(false),
+    m_completionQueue(nullptr),
+    m_threadPool(nullptr),
+    m_statistics(nullptr),
     m_cookie(nullptr),
-    m_reducerCookie(nullptr)
+    m_informationCookie(nullptr),
+    m_reducerCookie(nullptr),
+    m_snapshotStream(nullptr),
+    m_readStreamed(false),
+    m_pyramidDirty(false),
+    m_pyramidGeneration(0),
+    m_pyramidCookie(nullptr),
+    m_diskCache(nullptr),
+    m_reductionCached(false)
 {
 
 }
@@ -24,7 +95,16 @@ vvReader::vvReader()
 //------------------------------------------------------------------------------
 vvReader::~vvReader()
 {
-  // Wait for background processes to finish:
+  // Stop background processes and wait for them to finish:
+  m_token.cancel();
+  m_reducerToken.cancel();
+  m_pyramidToken.cancel();
+
+  if (m_informationFuture.valid())
+    {
+    m_informationFuture.wait();
+    }
+
   if (m_future.valid())
     {
     std::cout << "Waiting for file read to complete..." << std::endl;
@@ -36,13 +116,33 @@ vvReader::~vvReader()
     std::cout << "Waiting for async data reduction to complete..." << std::endl;
     m_reducerFuture.wait();
     }
+
+  if (m_pyramidFuture.valid())
+    {
+    m_pyramidFuture.wait();
+    }
+
+  for (auto &store : m_cacheStores)
+    {
+    store.wait();
+    }
+
+  if (m_completionQueue)
+    {
+    m_completionQueue->discard(this);
+    }
+
+  if (m_benchmark && m_statistics)
+    {
+    m_statistics->dump(std::cerr, m_statisticsPrefix + "/");
+    }
 }
 
 //------------------------------------------------------------------------------
 void vvReader::updateInformation()
 {
-  // Only update when the background thread is not running:
-  if (m_future.valid())
+  // Only update when the background threads are not running:
+  if (m_future.valid() || m_informationFuture.valid())
     {
     return;
     }
@@ -53,40 +153,39 @@ void vvReader::updateInformation()
 }
 
 //------------------------------------------------------------------------------
-void vvReader::update(const vvApplicationState &appState)
+bool vvReader::updateInformationAsync(const vvApplicationState &appState,
+                                      InformationCallback callback)
 {
-  // Are we currently reading the file?
-  if (m_future.valid())
+  this->bindApplicationState(appState);
+  if (m_future.valid() || m_informationFuture.valid())
     {
-    // Get the current state of the update thread:
-    std::future_status state = m_future.wait_for(std::chrono::milliseconds(0));
-
-    // We always use the async launch policy:
-    assert("Always async." && state != std::future_status::deferred);
-
-    if (state == std::future_status::ready)
-      {
-      // Clear the future.
-      m_future.get();
+    return false;
+    }
 
-      // Sync the cached data.
-      this->updateInformationCache();
-      this->updateDataCache();
+  this->syncReaderState();
+  m_informationCallback = std::move(callback);
+  assert("Cookie cleaned up." && m_informationCookie == nullptr);
+  m_informationCookie = appState.progress().addEntry("Reading File Header");
+  m_informationCookie->setEstimatedDuration(
+        this->estimatedDuration("/Information/execute"));
+  m_informationFuture = appState.threadPool().submit(
+        vvThreadPool::Priority(), &vvReader::internalExecuteReaderInformation,
+        this, vvStatistics::Clock::now());
+  return true;
+}
 
-      // Invalidate the reduced dataset as it is now out of date. This prevents
-      // LOD actors from displaying incorrect lowres data.
-      this->invalidateReducedData();
+//------------------------------------------------------------------------------
+void vvReader::update(const vvApplicationState &appState)
+{
+  this->bindApplicationState(appState);
 
-      // Clean up the progress monitor:
-      assert("Cookie exists." && m_cookie != nullptr);
-      appState.progress().removeEntry(m_cookie);
-      m_cookie = nullptr;
-      }
-    else
-      {
-      // Still running, do nothing.
-      return;
-      }
+  // Are we currently reading the file? Finished reads are collected by
+  // completeRead(), which resets m_future. The information pass uses the same
+  // reader, and is collected by completeInformation().
+  if (m_future.valid() || m_informationFuture.valid())
+    {
+    // Still running, do nothing.
+    return;
     }
 
   // At this point, we know the background thread is not running and the
@@ -97,42 +196,170 @@ void vvReader::update(const vvApplicationState &appState)
     {
     assert("Cookie cleaned up." && m_cookie == nullptr);
     m_cookie = appState.progress().addEntry("Reading Data File");
+    m_cookie->setEstimatedDuration(this->estimatedDuration("/Data/execute"));
+
+    m_token = vvCancellationToken();
+    m_reductionCached = false;
+    m_stream.reset();
+    if (!m_reducerFuture.valid() && this->streamingReduction())
+      {
+      this->beginStream(appState);
+      }
+    else if (!m_reducerFuture.valid() && m_diskCache->enabled())
+      { // Load the reduction of the new data while it is being read:
+      this->launchReduction(appState, CacheMode::Load);
+      }
 
-    m_future = std::async(std::launch::async,
-                          &vvReader::internalExecuteReaderData, this);
+    const std::size_t numPieces = this->numberOfPieces();
+    if (numPieces > 0)
+      {
+      m_future = this->launchPieceRead(appState, numPieces);
+      }
+    else
+      {
+      m_future = appState.threadPool().submit(
+            vvThreadPool::Priority(), &vvReader::internalExecuteReaderData,
+            this, m_token, vvStatistics::Clock::now(), m_stream);
+      }
 
     // Don't bother updating reduced data until the main data is up-to-date:
     return;
     }
 
+  // Rebuild the pyramid for new data. A running build for old data has been
+  // cancelled by invalidatePyramid() and is collected first:
+  if (m_pyramidDirty && !m_pyramidFuture.valid() && m_dataObject)
+    {
+    m_pyramidDirty = false;
+    assert("Cookie cleaned up." && m_pyramidCookie == nullptr);
+    m_pyramidCookie = appState.progress().addEntry("Generating Reductions");
+    double estimate = 0.;
+    for (std::size_t level = 0; level < m_reductionRatios.size(); ++level)
+      {
+      const double levelEstimate = this->estimatedDuration(
+            "/Pyramid/" + std::to_string(level) + "/execute");
+      if (levelEstimate < 0.)
+        { // No history for this level:
+        estimate = -1.;
+        break;
+        }
+      estimate += levelEstimate;
+      }
+    m_pyramidCookie->setEstimatedDuration(estimate);
+    m_pyramidToken = vvCancellationToken();
+    m_pyramidFuture = appState.threadPool().submit(
+          vvThreadPool::Priority(), &vvReader::internalExecutePyramid, this,
+          m_pyramidToken, m_dataObject, m_reductionRatios,
+          m_pyramidGeneration);
+    }
+
   // Update the reduced data as well. Logic is the same as above.
   if (m_reducerFuture.valid())
     {
-    std::chrono::seconds now(0);
-    std::future_status state = m_reducerFuture.wait_for(now);
-    assert("Always async." && state != std::future_status::deferred);
-    if (state == std::future_status::ready)
+    return;
+    }
+
+  this->syncReducerState();
+  if (this->reducerNeedsUpdate())
+    {
+    // Reductions loaded from the disk cache never run the reducer filter:
+    if (m_reductionCached && this->reductionCacheKey() == m_cachedParameters)
       {
-      m_reducerFuture.get(); // Clear the thread state.
-      this->updateReducedData();
-      assert("Cookie exists." && m_reducerCookie != nullptr);
-      appState.progress().removeEntry(m_reducerCookie);
-      m_reducerCookie = nullptr;
+      return;
       }
-    else
+
+    this->invalidateReducedData();
+    m_reductionCached = false;
+    this->launchReduction(appState, CacheMode::LoadOrCompute);
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvReader::bindApplicationState(const vvApplicationState &appState)
+{
+  m_completionQueue = &appState.completionQueue();
+  m_threadPool = &appState.threadPool();
+  m_diskCache = &appState.diskCache();
+  if (m_statistics == nullptr)
+    {
+    m_statistics = &appState.statistics();
+    m_statisticsPrefix = m_statistics->uniquePrefix("Reader");
+    }
+}
+
+//------------------------------------------------------------------------------
+double vvReader::estimatedDuration(const std::string &series) const
+{
+  const vvStatistics::Summary summary =
+      m_statistics->summary(m_statisticsPrefix + series);
+  return summary.count > 0 ? summary.mean : -1.;
+}
+
+//------------------------------------------------------------------------------
+void vvReader::launchReduction(const vvApplicationState &appState,
+                               CacheMode mode)
+{
+  m_cachedParameters = this->reductionCacheKey();
+  m_reductionCacheKey.clear();
+  if (!m_cachedParameters.empty() && m_diskCache->enabled())
+    {
+    m_reductionCacheKey = vvDiskCache::makeKey(m_fileName, m_cachedParameters);
+    }
+
+  if (m_reductionCacheKey.empty())
+    {
+    if (mode == CacheMode::Load)
       {
       return;
       }
+    mode = CacheMode::Compute;
+    }
+  else if (mode == CacheMode::LoadOrCompute &&
+           m_reductionCacheKey == m_missedCacheKey)
+    { // Already looked up while the data was read:
+    mode = CacheMode::Compute;
     }
 
-  this->syncReducerState();
-  if (this->reducerNeedsUpdate())
+  assert("Cookie cleaned up." && m_reducerCookie == nullptr);
+  m_reducerCookie = appState.progress().addEntry(
+        mode == CacheMode::Load ? "Loading Reduced Data"
+                                : "Generating Reduced Data");
+  m_reducerCookie->setEstimatedDuration(this->estimatedDuration(
+        mode == CacheMode::Load ? "/Reduced/cacheLoad" : "/Reduced/execute"));
+  m_reducerToken = vvCancellationToken();
+  m_reducerFuture = appState.threadPool().submit(
+        vvThreadPool::Priority(), &vvReader::internalExecuteReducer, this,
+        m_reducerToken, vvStatistics::Clock::now(), mode);
+}
+
+//------------------------------------------------------------------------------
+void vvReader::storeReduction(const vvApplicationState &appState)
+{
+  m_cacheStores.remove_if([](const std::future<void> &store)
     {
-    this->invalidateReducedData();
-    assert("Cookie cleaned up." && m_reducerCookie == nullptr);
-    m_reducerCookie = appState.progress().addEntry("Generating Reduced Data");
-    m_reducerFuture = std::async(std::launch::async,
-                                 &vvReader::internalExecuteReducer, this);
+    return store.wait_for(std::chrono::seconds(0)) ==
+        std::future_status::ready;
+    });
+
+  // Write a shallow copy, so the subclass may modify m_reducedData meanwhile:
+  vtkSmartPointer<vtkDataObject> data;
+  data.TakeReference(m_reducedData->NewInstance());
+  data->ShallowCopy(m_reducedData);
+
+  m_cacheStores.push_back(appState.threadPool().submit(
+        vvThreadPool::Priority(CacheStoreTier),
+        &vvReader::internalStoreReduction, this, m_reductionCacheKey, data));
+}
+
+//------------------------------------------------------------------------------
+void vvReader::internalStoreReduction(std::string key,
+                                      vtkSmartPointer<vtkDataObject> data)
+{
+  const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+  if (m_diskCache->store(key, data))
+    {
+    m_statistics->record(m_statisticsPrefix + "/Reduced/cacheStore",
+                         vvStatistics::elapsed(start));
     }
 }
 
@@ -148,6 +375,39 @@ vtkDataObject *vvReader::reducedDataObject() const
   return m_reducedData.Get();
 }
 
+//------------------------------------------------------------------------------
+void vvReader::setReductionRatios(std::vector<double> ratios)
+{
+  ratios.erase(std::remove_if(ratios.begin(), ratios.end(),
+                              [](double ratio)
+                              { return !(ratio > 0. && ratio <= 1.); }),
+               ratios.end());
+  std::sort(ratios.begin(), ratios.end(), std::greater<double>());
+  if (ratios != m_reductionRatios)
+    {
+    m_reductionRatios.swap(ratios);
+    this->invalidatePyramid();
+    }
+}
+
+//------------------------------------------------------------------------------
+vtkDataObject *vvReader::reducedDataObject(std::size_t level) const
+{
+  return level < m_pyramid.size() ? m_pyramid[level].Get() : nullptr;
+}
+
+//------------------------------------------------------------------------------
+bool vvReader::reductionReady(std::size_t level) const
+{
+  return this->reducedDataObject(level) != nullptr;
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvReader::reductionMemorySize(std::size_t level) const
+{
+  return vvMemoryManager::memorySize(this->reducedDataObject(level));
+}
+
 //------------------------------------------------------------------------------
 const vtkBoundingBox &vvReader::bounds() const
 {
@@ -155,53 +415,646 @@ const vtkBoundingBox &vvReader::bounds() const
 }
 
 //------------------------------------------------------------------------------
-void vvReader::internalExecuteReaderData()
+std::size_t vvReader::numberOfPieces() const
+{
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject>
+vvReader::executeReaderPiece(std::size_t, std::size_t,
+                             const vvCancellationToken &)
+{
+  return vtkSmartPointer<vtkDataObject>();
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject>
+vvReader::assemblePieces(
+    const std::vector<vtkSmartPointer<vtkDataObject> > &pieces)
+{
+  vtkSmartPointer<vtkMultiBlockDataSet> result =
+      vtkSmartPointer<vtkMultiBlockDataSet>::New();
+  result->SetNumberOfBlocks(static_cast<unsigned int>(pieces.size()));
+  for (std::size_t i = 0; i < pieces.size(); ++i)
+    {
+    result->SetBlock(static_cast<unsigned int>(i), pieces[i].Get());
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+std::future<void> vvReader::launchPieceRead(const vvApplicationState &appState,
+                                            std::size_t numPieces)
+{
+  std::shared_ptr<PieceRead> read =
+      std::make_shared<PieceRead>(numPieces, m_token,
+                                  vvStatistics::Clock::now(), m_stream);
+  std::future<void> result = read->done.get_future();
+
+  // The pieces' own futures are not needed, completion is reported through
+  // read->done:
+  for (std::size_t piece = 0; piece < numPieces; ++piece)
+    {
+    appState.threadPool().submit(
+          vvThreadPool::Priority(), &vvReader::internalExecuteReaderPiece,
+          this, read, piece);
+    }
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void vvReader::internalExecuteReaderPiece(std::shared_ptr<PieceRead> read,
+                                          std::size_t piece)
 {
-  vtkTimerLog *log = nullptr;
-  if (m_benchmark)
+  std::call_once(read->started, [this, &read]()
+    {
+    m_cookie->start();
+    if (read->stream)
+      {
+      read->stream->cookie->start();
+      }
+    read->start = vvStatistics::Clock::now();
+    m_statistics->record(m_statisticsPrefix + "/Data/queueWait",
+                         vvStatistics::elapsed(read->submitted));
+    });
+
+  try
+    {
+    if (!read->token.cancelled())
+      {
+      read->pieces[piece] =
+          this->executeReaderPiece(piece, read->pieces.size(), read->token);
+      }
+    }
+  catch (...)
+    {
+    std::lock_guard<std::mutex> lock(read->errorMutex);
+    if (!read->error)
+      {
+      read->error = std::current_exception();
+      }
+    }
+
+  if (--read->remaining > 0)
+    {
+    return;
+    }
+
+  // This was the last piece. The other tasks have finished writing to read,
+  // so it is safe to use without locking from here on:
+  if (!read->error && !read->token.cancelled())
     {
-    log = vtkTimerLog::New();
-    std::cerr << "Updating full dataset.\n";
-    log->StartTimer();
+    try
+      {
+      m_assembledData = this->assemblePieces(read->pieces);
+      }
+    catch (...)
+      {
+      read->error = std::current_exception();
+      }
     }
+  read->pieces.clear();
+
+  m_statistics->record(m_statisticsPrefix + "/Data/execute",
+                       vvStatistics::elapsed(read->start));
+  this->endStream(read->stream);
 
-  this->executeReaderData();
+  // As in internalExecuteReaderData, the handler is queued even on failure so
+  // that the exception is rethrown from m_future.get() on the GUI thread:
+  m_completionQueue->push(this, [this](const vvApplicationState &appState)
+    {
+    this->completeRead(appState);
+    });
 
-  if (log != nullptr)
+  if (read->error)
+    {
+    read->done.set_exception(read->error);
+    }
+  else
     {
-    log->StopTimer();
-    std::ostringstream out;
-    out << "Full dataset ready (" << log->GetElapsedTime() << "s)\n";
-    std::cerr << out.str();
-    log->Delete();
+    read->done.set_value();
     }
+}
 
-  Vrui::requestUpdate();
+//------------------------------------------------------------------------------
+void vvReader::internalExecuteReaderInformation(
+    vvStatistics::Clock::time_point submitted)
+{
+  m_statistics->record(m_statisticsPrefix + "/Information/queueWait",
+                       vvStatistics::elapsed(submitted));
+  m_informationCookie->start();
+
+  auto handler = [this](const vvApplicationState &appState)
+    {
+    this->completeInformation(appState);
+    };
+
+  const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+  try
+    {
+    this->executeReaderInformation();
+    }
+  catch (...)
+    {
+    m_completionQueue->push(this, handler);
+    throw;
+    }
+  m_statistics->record(m_statisticsPrefix + "/Information/execute",
+                       vvStatistics::elapsed(start));
+
+  m_completionQueue->push(this, handler);
 }
 
 //------------------------------------------------------------------------------
-void vvReader::internalExecuteReducer()
+void vvReader::internalExecuteReaderData(
+    vvCancellationToken token, vvStatistics::Clock::time_point submitted,
+    std::shared_ptr<Stream> stream)
 {
-  vtkTimerLog *log = nullptr;
-  if (m_benchmark)
+  m_statistics->record(m_statisticsPrefix + "/Data/queueWait",
+                       vvStatistics::elapsed(submitted));
+  m_cookie->start();
+  if (stream)
     {
-    log = vtkTimerLog::New();
-    std::cerr << "Generating reduced data.\n";
-    log->StartTimer();
+    stream->cookie->start();
     }
 
-  this->executeReducer();
+  // The handler must be queued even if the read throws, so that the exception
+  // is rethrown from m_future.get() on the GUI thread:
+  auto handler = [this](const vvApplicationState &appState)
+    {
+    this->completeRead(appState);
+    };
 
-  if (log != nullptr)
+  const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+  try
+    {
+    this->executeReaderData(token);
+    }
+  catch (...)
     {
-    log->StopTimer();
-    std::ostringstream out;
-    out << "Reduced data ready (" << log->GetElapsedTime() << "s)\n";
-    std::cerr << out.str();
-    log->Delete();
+    this->endStream(stream);
+    m_completionQueue->push(this, handler);
+    throw;
+    }
+  m_statistics->record(m_statisticsPrefix + "/Data/execute",
+                       vvStatistics::elapsed(start));
+
+  this->endStream(stream);
+  m_completionQueue->push(this, handler);
+}
+
+//------------------------------------------------------------------------------
+void vvReader::internalExecuteReducer(
+    vvCancellationToken token, vvStatistics::Clock::time_point submitted,
+    CacheMode mode)
+{
+  m_statistics->record(m_statisticsPrefix + "/Reduced/queueWait",
+                       vvStatistics::elapsed(submitted));
+  m_reducerCookie->start();
+
+  auto handler = [this, mode](const vvApplicationState &appState)
+    {
+    this->completeReduction(appState, mode);
+    };
+
+  try
+    {
+    if (mode != CacheMode::Compute)
+      {
+      const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+      m_cachedReduction = m_diskCache->load(m_reductionCacheKey);
+      if (m_cachedReduction)
+        {
+        m_statistics->record(m_statisticsPrefix + "/Reduced/cacheLoad",
+                             vvStatistics::elapsed(start));
+        }
+      }
+
+    if (!m_cachedReduction && mode != CacheMode::Load)
+      {
+      const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+      this->executeReducer(token);
+      m_statistics->record(m_statisticsPrefix + "/Reduced/execute",
+                           vvStatistics::elapsed(start));
+      }
+    }
+  catch (...)
+    {
+    m_completionQueue->push(this, handler);
+    throw;
+    }
+
+  m_completionQueue->push(this, handler);
+}
+
+//------------------------------------------------------------------------------
+void vvReader::completeInformation(const vvApplicationState &appState)
+{
+  // Clean up before get(), which rethrows errors from the background thread:
+  assert("Cookie exists." && m_informationCookie != nullptr);
+  appState.progress().removeEntry(m_informationCookie);
+  m_informationCookie = nullptr;
+  InformationCallback callback;
+  callback.swap(m_informationCallback);
+  m_informationFuture.get();
+
+  const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+  this->updateInformationCache();
+  m_statistics->record(m_statisticsPrefix + "/Information/exportResult",
+                       vvStatistics::elapsed(start));
+
+  if (callback)
+    {
+    callback();
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvReader::completeRead(const vvApplicationState &appState)
+{
+  // Clean up first, get() rethrows errors from the background thread:
+  assert("Cookie exists." && m_cookie != nullptr);
+  appState.progress().removeEntry(m_cookie);
+  m_cookie = nullptr;
+  m_stream.reset();
+  const bool streamed = m_readStreamed;
+  m_readStreamed = false;
+
+  // Clear the future. The handler is queued just before the task returns, so
+  // this may block very briefly:
+  m_future.get();
+
+  // Sync the cached data.
+  const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+  this->updateInformationCache();
+  this->updateDataCache();
+  m_assembledData = nullptr;
+  m_statistics->record(m_statisticsPrefix + "/Data/exportResult",
+                       vvStatistics::elapsed(start));
+
+  // Invalidate the reduced dataset as it is now out of date. This prevents
+  // LOD actors from displaying incorrect lowres data. Streamed reductions and
+  // those loaded from the disk cache already match the new data.
+  if (!streamed && !m_reductionCached)
+    {
+    this->invalidateReducedData();
+    }
+  if (!streamed)
+    { // Snapshots of an older stream that is still running are out of date:
+    m_snapshotStream = nullptr;
+    }
+  this->invalidatePyramid();
+}
+
+//------------------------------------------------------------------------------
+void vvReader::completeReduction(const vvApplicationState &appState,
+                                 CacheMode mode)
+{
+  // Clean up first, get() rethrows errors from the background thread:
+  assert("Cookie exists." && m_reducerCookie != nullptr);
+  appState.progress().removeEntry(m_reducerCookie);
+  m_reducerCookie = nullptr;
+  m_reducerFuture.get(); // Clear the thread state.
+
+  const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+  if (m_cachedReduction)
+    {
+    m_reducedData = m_cachedReduction;
+    m_cachedReduction = nullptr;
+    m_reductionCached = true;
+    }
+  else if (mode == CacheMode::Load)
+    {
+    m_missedCacheKey = m_reductionCacheKey;
+    }
+  else
+    {
+    this->updateReducedData();
+    if (!m_reductionCacheKey.empty() && m_reducedData)
+      {
+      this->storeReduction(appState);
+      }
+    }
+  m_statistics->record(m_statisticsPrefix + "/Reduced/exportResult",
+                       vvStatistics::elapsed(start));
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject>
+vvReader::reduceLevel(vtkDataObject *, double, const vvCancellationToken &)
+{
+  return vtkSmartPointer<vtkDataObject>();
+}
+
+//------------------------------------------------------------------------------
+std::string vvReader::reductionCacheKey() const
+{
+  return std::string();
+}
+
+//------------------------------------------------------------------------------
+void vvReader::internalExecutePyramid(vvCancellationToken token,
+                                      vtkSmartPointer<vtkDataObject> input,
+                                      std::vector<double> ratios,
+                                      unsigned long generation)
+{
+  auto handler = [this](const vvApplicationState &appState)
+    {
+    this->completePyramid(appState);
+    };
+  m_pyramidCookie->start();
+
+  try
+    {
+    double inputRatio = 1.;
+    for (std::size_t level = 0; level < ratios.size(); ++level)
+      {
+      if (token.cancelled())
+        {
+        break;
+        }
+
+      const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+      vtkSmartPointer<vtkDataObject> output =
+          this->reduceLevel(input.Get(), ratios[level] / inputRatio, token);
+      if (!output || token.cancelled())
+        {
+        break;
+        }
+      m_statistics->record(m_statisticsPrefix + "/Pyramid/" +
+                           std::to_string(level) + "/execute",
+                           vvStatistics::elapsed(start));
+
+      // Show each level as soon as it is ready:
+      m_completionQueue->push(this,
+                              [this, level, output, generation]
+                              (const vvApplicationState &)
+        {
+        this->completeReductionLevel(level, output, generation);
+        });
+
+      input = output;
+      inputRatio = ratios[level];
+      }
+    }
+  catch (...)
+    {
+    m_completionQueue->push(this, handler);
+    throw;
+    }
+
+  m_completionQueue->push(this, handler);
+}
+
+//------------------------------------------------------------------------------
+void vvReader::completeReductionLevel(std::size_t level,
+                                      vtkSmartPointer<vtkDataObject> data,
+                                      unsigned long generation)
+{
+  // Drop levels computed for old data or ratios:
+  if (generation != m_pyramidGeneration)
+    {
+    return;
+    }
+
+  if (m_pyramid.size() != m_reductionRatios.size())
+    {
+    m_pyramid.resize(m_reductionRatios.size());
+    }
+  m_pyramid[level] = data;
+}
+
+//------------------------------------------------------------------------------
+void vvReader::completePyramid(const vvApplicationState &appState)
+{
+  assert("Cookie exists." && m_pyramidCookie != nullptr);
+  appState.progress().removeEntry(m_pyramidCookie);
+  m_pyramidCookie = nullptr;
+  m_pyramidFuture.get(); // Clear the thread state, rethrows errors.
+}
+
+//------------------------------------------------------------------------------
+void vvReader::invalidatePyramid()
+{
+  m_pyramidToken.cancel();
+  m_pyramid.clear();
+  ++m_pyramidGeneration;
+  m_pyramidDirty = !m_reductionRatios.empty();
+}
+
+//------------------------------------------------------------------------------
+bool vvReader::streamingReduction() const
+{
+  return false;
+}
+
+//------------------------------------------------------------------------------
+void vvReader::beginStreamingReduction()
+{
+}
+
+//------------------------------------------------------------------------------
+void vvReader::reduceChunk(vtkDataObject *, const vvCancellationToken &)
+{
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject> vvReader::reducedSnapshot()
+{
+  return vtkSmartPointer<vtkDataObject>();
+}
+
+//------------------------------------------------------------------------------
+void vvReader::pushChunk(vtkSmartPointer<vtkDataObject> chunk)
+{
+  // m_stream is only changed while no read is running. It is null for reads
+  // that are not streamed, even while an older stream is still reducing:
+  std::shared_ptr<Stream> stream = m_stream;
+  if (!stream)
+    {
+    return;
+    }
+
+  {
+  std::lock_guard<std::mutex> lock(stream->mutex);
+  assert("Stream still open." && !stream->inputEnded);
+  stream->chunks.push_back(chunk);
+  if (stream->consumerActive)
+    {
+    return;
+    }
+  stream->consumerActive = true;
+  }
+
+  m_threadPool->submit(vvThreadPool::Priority(), &vvReader::consumeChunks,
+                       this, stream);
+}
+
+//------------------------------------------------------------------------------
+void vvReader::beginStream(const vvApplicationState &appState)
+{
+  // The previous reduction does not match the data being read:
+  this->invalidateReducedData();
+
+  assert("Cookie cleaned up." && m_reducerCookie == nullptr);
+  m_reducerCookie = appState.progress().addEntry("Generating Reduced Data");
+  m_reducerCookie->setEstimatedDuration(
+        this->estimatedDuration("/Reduced/execute"));
+  m_reducerToken = vvCancellationToken();
+  m_stream = std::make_shared<Stream>(m_reducerToken, m_reducerCookie);
+  m_reducerFuture = m_stream->done.get_future();
+  m_snapshotStream = m_stream.get();
+  m_readStreamed = true;
+
+  this->beginStreamingReduction();
+}
+
+//------------------------------------------------------------------------------
+void vvReader::endStream(std::shared_ptr<Stream> stream)
+{
+  if (!stream)
+    {
+    return;
+    }
+
+  {
+  std::lock_guard<std::mutex> lock(stream->mutex);
+  stream->inputEnded = true;
+  if (stream->consumerActive)
+    { // The running consumer will finish the stream.
+    return;
+    }
+  stream->consumerActive = true;
+  }
+
+  // Publish the final snapshot, even if there were no chunks:
+  m_threadPool->submit(vvThreadPool::Priority(), &vvReader::consumeChunks,
+                       this, stream);
+}
+
+//------------------------------------------------------------------------------
+void vvReader::consumeChunks(std::shared_ptr<Stream> stream)
+{
+  vtkSmartPointer<vtkDataObject> snapshot;
+
+  std::unique_lock<std::mutex> lock(stream->mutex);
+  for (;;)
+    {
+    if (!stream->chunks.empty())
+      {
+      vtkSmartPointer<vtkDataObject> chunk = stream->chunks.front();
+      stream->chunks.pop_front();
+      lock.unlock();
+
+      if (!stream->error && !stream->token.cancelled())
+        {
+        try
+          {
+          this->reduceChunk(chunk.Get(), stream->token);
+          }
+        catch (...)
+          {
+          stream->error = std::current_exception();
+          }
+        }
+
+      lock.lock();
+      continue;
+      }
+
+    // Caught up with the reader. Take the snapshot while still active, so
+    // that no other consumer calls reduceChunk() concurrently:
+    lock.unlock();
+    snapshot = nullptr;
+    if (!stream->error && !stream->token.cancelled())
+      {
+      try
+        {
+        snapshot = this->reducedSnapshot();
+        }
+      catch (...)
+        {
+        stream->error = std::current_exception();
+        }
+      }
+    lock.lock();
+
+    // More chunks may have arrived during the snapshot:
+    if (stream->chunks.empty())
+      {
+      break;
+      }
+    }
+
+  if (snapshot && stream->firstSnapshot)
+    {
+    stream->firstSnapshot = false;
+    m_statistics->record(m_statisticsPrefix + "/Reduced/firstSnapshot",
+                         vvStatistics::elapsed(stream->start));
+    }
+
+  // endStream() may have run during the snapshot, leaving the end of the
+  // stream to this consumer, so inputEnded is checked under the lock:
+  if (!stream->inputEnded)
+    {
+    // Queue the snapshot before handing over, so that no later consumer can
+    // finish the stream (and let the reader be destroyed) while this one still
+    // uses it:
+    const Stream *source = stream.get();
+    m_completionQueue->push(
+          this, [this, source, snapshot](const vvApplicationState &appState)
+      {
+      this->completeSnapshot(source, snapshot, false, appState);
+      });
+    stream->consumerActive = false;
+    return;
+    }
+
+  // No more chunks or consumers can arrive:
+  lock.unlock();
+
+  m_statistics->record(m_statisticsPrefix + "/Reduced/execute",
+                       vvStatistics::elapsed(stream->start));
+
+  // As for reads, the handler is queued before the future becomes ready:
+  const Stream *source = stream.get();
+  m_completionQueue->push(
+        this, [this, source, snapshot](const vvApplicationState &appState)
+    {
+    this->completeSnapshot(source, snapshot, true, appState);
+    });
+
+  if (stream->error)
+    {
+    stream->done.set_exception(stream->error);
+    }
+  else
+    {
+    stream->done.set_value();
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvReader::completeSnapshot(const Stream *stream,
+                                vtkSmartPointer<vtkDataObject> snapshot,
+                                bool final, const vvApplicationState &appState)
+{
+  if (snapshot && stream == m_snapshotStream)
+    {
+    m_reducedData = snapshot;
+    }
+
+  if (!final)
+    {
+    return;
     }
 
-  Vrui::requestUpdate();
+  assert("Cookie exists." && m_reducerCookie != nullptr);
+  appState.progress().removeEntry(m_reducerCookie);
+  m_reducerCookie = nullptr;
+  m_reducerFuture.get(); // Clear the thread state, rethrows errors.
 }
 
 //------------------------------------------------------------------------------
@@ -1,24 +1,51 @@
 #ifndef VVREADER_H
 #define VVREADER_H
 
+#include "vvCancellationToken.h"
+#include "vvStatistics.h"
+
 #include <vtkBoundingBox.h>
 #include <vtkSmartPointer.h>
 
 #include <chrono>
+#include <functional>
 #include <future>
+#include <list>
+#include <memory>
 #include <string>
+#include <vector>
 
 class vtkDataObject;
 class vvApplicationState;
+class vvCompletionQueue;
+class vvDiskCache;
 class vvProgressCookie;
+class vvThreadPool;
 
 /**
  * @brief The vvReader class is a base interface to a data source. It supports
  * asynchronous updates, and data reduction for LOD rendering.
+ *
+ * Partitioned data can be read in parallel by implementing numberOfPieces(),
+ * executeReaderPiece(), and optionally assemblePieces().
+ *
+ * Readers that implement reductionCacheKey() keep their reduced data in
+ * vvApplicationState::diskCache(). When a file is read, its reduction is
+ * loaded from the cache concurrently with the read, so the reduced LOD of an
+ * unchanged file is available without recomputing it on the next run.
  */
 class vvReader
 {
 public:
+  /**
+   * Tier of disk cache writes in the vvThreadPool, after all other background
+   * work.
+   */
+  static const unsigned int CacheStoreTier = 9;
+
+  /** Called when updateInformationAsync() has finished. */
+  using InformationCallback = std::function<void()>;
+
   vvReader();
   virtual ~vvReader();
 
@@ -27,16 +54,30 @@ public:
    * lightweight data, if any.
    *
    * This method does nothing if the file reader is already doing an
-   * asynchronous read from a call to update().
+   * asynchronous read from a call to update() or updateInformationAsync().
    */
   void updateInformation();
 
   /**
-   * Trigger an update cycle. This is the synchronization point between the
-   * background reading thread and the main GUI thread. It will start a new
-   * asynchronous read if the reading parameters have changed, and it will
-   * update heavier data (e.g. dataObject()) the first time it is called after
-   * a background read completes.
+   * Read the file's metadata in a background thread, with its own vvProgress
+   * entry. The lightweight data is updated when the result is collected from
+   * vvApplicationState::completionQueue(), after which @a callback is called
+   * from the GUI thread, e.g. to set up bounds and menus. Returns false and
+   * does nothing if a read or information pass is already running.
+   */
+  bool updateInformationAsync(const vvApplicationState &appState,
+                              InformationCallback callback =
+                              InformationCallback());
+
+  /** Returns true while updateInformationAsync() is running. */
+  bool updatingInformation() const { return m_informationFuture.valid(); }
+
+  /**
+   * Trigger an update cycle. This starts a new asynchronous read if the
+   * reading parameters have changed. Heavier data (e.g. dataObject()) is
+   * updated when the finished read is collected from
+   * vvApplicationState::completionQueue() at the start of the next frame.
+   * Nothing is started until a pending updateInformationAsync() has finished.
    */
   void update(const vvApplicationState &appState);
 
@@ -82,6 +123,40 @@ public:
    */
   virtual vtkDataObject* reducedDataObject() const;
 
+  /**
+   * Target ratios of the reduction pyramid, relative to the full data, e.g.
+   * {0.1, 0.01} for a 10% and a 1% level. Whenever dataObject() changes, the
+   * levels are computed in the background with reduceLevel(), finest first,
+   * each from the previous (finer) level rather than from the full data. The
+   * ratios are sorted in descending order; ratios outside (0, 1] are dropped.
+   * Empty by default, which disables the pyramid. The pyramid is independent
+   * of reducedDataObject().
+   * @{
+   */
+  const std::vector<double>& reductionRatios() const
+  { return m_reductionRatios; }
+  void setReductionRatios(std::vector<double> ratios);
+  /** @} */
+
+  /** The number of pyramid levels, i.e. reductionRatios().size(). */
+  std::size_t numberOfReductionLevels() const
+  { return m_reductionRatios.size(); }
+
+  /**
+   * Pyramid level @a level (0 is the finest) for the current dataObject(), or
+   * nullptr if it is not ready. Levels become ready one at a time.
+   */
+  vtkDataObject* reducedDataObject(std::size_t level) const;
+
+  /** True if reducedDataObject(@a level) is ready. */
+  bool reductionReady(std::size_t level) const;
+
+  /**
+   * Memory used by pyramid level @a level in bytes, 0 if it is not ready. See
+   * vvMemoryManager::memorySize().
+   */
+  std::size_t reductionMemorySize(std::size_t level) const;
+
   /**
    * The bounding box for the dataObject().
    */
@@ -92,22 +167,64 @@ public:
   const std::string& fileName() const { return m_fileName; }
   /** @} */
 
-  /** Set true to print timing information to std::cerr. @{ */
+  /**
+   * If true, subclasses that support it map raw array payloads into memory
+   * with vvMappedFile instead of reading them into heap arrays. This avoids
+   * holding the file twice in memory during the read and lets the OS page the
+   * data in lazily. Default is false. Changing the mode does not trigger a new
+   * read by itself; subclasses should treat it as a reader parameter.
+   * @{
+   */
+  bool memoryMapped() const { return m_memoryMapped; }
+  void setMemoryMapped(bool mapped) { m_memoryMapped = mapped; }
+  /** @} */
+
+  /**
+   * Prefix of this reader's series in vvApplicationState::statistics(): the
+   * full read is recorded under "<prefix>/Data/...", the reduction under
+   * "<prefix>/Reduced/...", the pyramid levels under
+   * "<prefix>/Pyramid/<level>/...", and asynchronous information passes under
+   * "<prefix>/Information/...". Assigned by the first call to update() or
+   * updateInformationAsync().
+   */
+  const std::string& statisticsPrefix() const { return m_statisticsPrefix; }
+
+  /**
+   * Set true to print diagnostics to std::cerr, including this reader's
+   * statistics when it is destroyed. @{ */
   bool benchmark() const { return m_benchmark; }
   void setBenchmark(bool benchmark) { m_benchmark = benchmark; }
   /** @} */
 
 protected:
+  /**
+   * Pass a chunk of newly read data to the streaming reducer. Call from
+   * executeReaderData() or executeReaderPiece(); thread-safe. Does nothing
+   * unless the current read is streamed, see streamingReduction().
+   */
+  void pushChunk(vtkSmartPointer<vtkDataObject> chunk);
+
   bool m_benchmark;
+  bool m_memoryMapped;
   std::string m_fileName;
   vtkSmartPointer<vtkDataObject> m_dataObject;
   vtkSmartPointer<vtkDataObject> m_reducedData;
   vtkBoundingBox m_bounds;
 
+  vvCompletionQueue *m_completionQueue;
+  vvThreadPool *m_threadPool; // Set by update().
+
+  vvStatistics *m_statistics;
+  std::string m_statisticsPrefix;
+
   std::future<void> m_future;
+  vvCancellationToken m_token;
   vvProgressCookie *m_cookie;
+  vvProgressCookie *m_informationCookie; // Set by updateInformationAsync().
+  vtkSmartPointer<vtkDataObject> m_assembledData; // Output of piece mode.
 
   std::future<void> m_reducerFuture;
+  vvCancellationToken m_reducerToken;
   vvProgressCookie *m_reducerCookie;
 
 private: // Virtual API:
@@ -127,7 +244,8 @@ private: // Virtual API:
   /**
    * Execute the reader to read file metadata. This is called from a background
    * thread. Typical implementations can simply call UpdateInformation() on the
-   * VTK reader.
+   * VTK reader. Progress can be reported through m_informationCookie, which
+   * is nullptr unless called from updateInformationAsync().
    */
   virtual void executeReaderInformation() = 0;
 
@@ -140,17 +258,52 @@ private: // Virtual API:
   /**
    * Execute the reader to read the data object from the file. This is called
    * from a background thread. Typical implementations may simply call
-   * Update() on the VTK reader.
+   * Update() on the VTK reader. If @a token is cancelled, the read should stop
+   * as soon as possible. See vvCancellationToken::AbortObserver. Progress
+   * can be reported through m_cookie, see vvProgressCookie::Observer. If
+   * memoryMapped() is set, array payloads should be mapped with vvMappedFile
+   * where the file format allows it.
    */
-  virtual void executeReaderData() = 0;
+  virtual void executeReaderData(const vvCancellationToken &token) = 0;
 
   /**
    * Copy any heavy data from the VTK reader to caching variables on the
    * vvReader subclass. This should, at minimum, update m_bounds and
-   * m_dataObject.
+   * m_dataObject. In piece mode (see numberOfPieces()), the assembled output
+   * is in m_assembledData instead.
    */
   virtual void updateDataCache() = 0;
 
+  /**
+   * Return the number of independent pieces to split the next read into, or 0
+   * (the default) to read with a single executeReaderData() call. Called from
+   * the GUI thread after syncReaderState(). Partitioned files (e.g. .pvtu or
+   * multiblock files) can return their number of pieces to have them read
+   * concurrently by the vvThreadPool.
+   */
+  virtual std::size_t numberOfPieces() const;
+
+  /**
+   * Read piece @a piece of @a numPieces and return its data. In piece mode,
+   * this is called instead of executeReaderData() from several background
+   * threads at once, so implementations must not share VTK readers between
+   * pieces. If @a token is cancelled, the read should stop as soon as
+   * possible. The default implementation returns nullptr.
+   */
+  virtual vtkSmartPointer<vtkDataObject>
+  executeReaderPiece(std::size_t piece, std::size_t numPieces,
+                     const vvCancellationToken &token);
+
+  /**
+   * Combine the pieces returned by executeReaderPiece(), in piece order. This
+   * is called from the background thread that finished the last piece, and
+   * its result is stored in m_assembledData. The default implementation
+   * returns a vtkMultiBlockDataSet with one block per piece; override to
+   * e.g. append the pieces into a single dataset instead.
+   */
+  virtual vtkSmartPointer<vtkDataObject>
+  assemblePieces(const std::vector<vtkSmartPointer<vtkDataObject> > &pieces);
+
   /**
    * Sync the VTK reducer filter's state. Do not modify the reducer outside of
    * this method, as it may be executing in a background thread.
@@ -166,23 +319,225 @@ private: // Virtual API:
 
   /**
    * Execute the VTK reducer filter. This is executed in a background thread.
-   * Typical implementations simply call Update() on the filter.
+   * Typical implementations simply call Update() on the filter. If @a token is
+   * cancelled, the reduction should stop as soon as possible. Progress can be
+   * reported through m_reducerCookie.
    */
-  virtual void executeReducer() = 0;
+  virtual void executeReducer(const vvCancellationToken &token) = 0;
 
   /**
    * Copy the output of the VTK reducer filter to m_reducedData.
    */
   virtual void updateReducedData() = 0;
 
+  /**
+   * Return true to reduce the data while it is being read (streaming mode).
+   * Called from the GUI thread before a read is launched; the default returns
+   * false. In streaming mode, executeReaderData() (or executeReaderPiece())
+   * passes the data to pushChunk() as it is read, and reduceChunk() folds
+   * each chunk into the reduction concurrently with the rest of the read.
+   * reducedDataObject() is updated with reducedSnapshot() whenever the reducer
+   * catches up with the reader, so a reduced LOD is available long before
+   * dataObject(). The regular executeReducer() pass is not used for streamed
+   * reads, so reducerNeedsUpdate() should return false for them.
+   */
+  virtual bool streamingReduction() const;
+
+  /**
+   * Reset the incremental reducer for a new streaming read. Called from the
+   * GUI thread.
+   */
+  virtual void beginStreamingReduction();
+
+  /**
+   * Fold @a chunk into the reduction. Called from a background thread, one
+   * chunk at a time and in the order they were pushed. If @a token is
+   * cancelled, this should return as soon as possible.
+   */
+  virtual void reduceChunk(vtkDataObject *chunk,
+                           const vvCancellationToken &token);
+
+  /**
+   * Return the reduction of all chunks so far as a new data object that will
+   * not be modified by later reduceChunk() calls. Called from the same
+   * background thread as reduceChunk().
+   */
+  virtual vtkSmartPointer<vtkDataObject> reducedSnapshot();
+
+  /**
+   * Reduce @a input to @a ratio of its size for the reduction pyramid (see
+   * setReductionRatios()). @a input is either dataObject() or the previous
+   * pyramid level, and must not be modified. Called from a background thread;
+   * the levels of a pyramid are computed one at a time. If @a token is
+   * cancelled, this should return as soon as possible. The default
+   * implementation returns nullptr, which stops the pyramid at this level.
+   */
+  virtual vtkSmartPointer<vtkDataObject>
+  reduceLevel(vtkDataObject *input, double ratio,
+              const vvCancellationToken &token);
+
+  /**
+   * Return a string describing every reader and reducer parameter that
+   * affects reducedDataObject(), to cache it in vvApplicationState::diskCache()
+   * together with the file's path, size, and modification time. Called from
+   * the GUI thread. The default returns an empty string, which disables
+   * caching. Streamed reductions are never cached.
+   */
+  virtual std::string reductionCacheKey() const;
+
 private: // Internal methods:
+  /** Shared state of a read split into pieces. */
+  struct PieceRead;
+
+  /** How internalExecuteReducer() uses the disk cache. */
+  enum class CacheMode
+  {
+    Compute,       // Run executeReducer() only.
+    Load,          // Load from the cache only; used while the data is read.
+    LoadOrCompute  // Run executeReducer() if the cached entry is missing.
+  };
+
+  /** Shared state of a streaming reduction. */
+  struct Stream;
+
+  /** Remember the services of @a appState used by background tasks. */
+  void bindApplicationState(const vvApplicationState &appState);
+
+  /**
+   * Mean of this reader's statistics @a series (e.g. "/Data/execute"), to
+   * predict progress entry durations, or -1 if nothing has been recorded.
+   */
+  double estimatedDuration(const std::string &series) const;
+
+  /**
+   * Submit one task per piece to the thread pool. The returned future becomes
+   * ready once the pieces have been assembled.
+   */
+  std::future<void> launchPieceRead(const vvApplicationState &appState,
+                                    std::size_t numPieces);
+
+  /**
+   * Read a single piece. The task finishing the last piece assembles the
+   * result and queues completeRead().
+   */
+  void internalExecuteReaderPiece(std::shared_ptr<PieceRead> read,
+                                  std::size_t piece);
+
+  /**
+   * Set up a streaming reduction for the read about to be launched. The
+   * stream's future is stored in m_reducerFuture.
+   */
+  void beginStream(const vvApplicationState &appState);
+
+  /**
+   * Mark the end of the streamed input of a read. Called from the background
+   * thread once the read has finished, even if it failed. Does nothing if
+   * @a stream is null, i.e. the read is not streamed.
+   */
+  void endStream(std::shared_ptr<Stream> stream);
+
+  /**
+   * Reduce pushed chunks until the queue is empty, then publish a snapshot.
+   * At most one consumer task runs per stream.
+   */
+  void consumeChunks(std::shared_ptr<Stream> stream);
+
+  /**
+   * Compute the pyramid levels for @a ratios from @a input, queueing
+   * completeReductionLevel() for each level and completePyramid() at the end.
+   */
+  void internalExecutePyramid(vvCancellationToken token,
+                              vtkSmartPointer<vtkDataObject> input,
+                              std::vector<double> ratios,
+                              unsigned long generation);
+
+  /**
+   * Collect a pyramid level computed for m_pyramidGeneration @a generation.
+   * Called from the GUI thread.
+   */
+  void completeReductionLevel(std::size_t level,
+                              vtkSmartPointer<vtkDataObject> data,
+                              unsigned long generation);
+
+  /** Collect a finished pyramid execution. Called from the GUI thread. */
+  void completePyramid(const vvApplicationState &appState);
+
+  /** Drop all pyramid levels and schedule them to be recomputed. */
+  void invalidatePyramid();
+
+  /**
+   * Submit a reduction task for the current reducer state. If caching is
+   * enabled, m_reductionCacheKey is set for the task.
+   */
+  void launchReduction(const vvApplicationState &appState, CacheMode mode);
+
+  /**
+   * Write m_reducedData to the disk cache in a low priority background task.
+   * Called from the GUI thread.
+   */
+  void storeReduction(const vvApplicationState &appState);
+
+  /** Body of a storeReduction() task. */
+  void internalStoreReduction(std::string key,
+                              vtkSmartPointer<vtkDataObject> data);
+
+  /**
+   * Show a snapshot of @a stream, unless a newer read that was not streamed
+   * has replaced its data. Called from the GUI thread.
+   */
+  void completeSnapshot(const Stream *stream,
+                        vtkSmartPointer<vtkDataObject> snapshot, bool final,
+                        const vvApplicationState &appState);
+
   /**
    * Trampoline that wraps a virtual call in a vvProgress notification. @{
    */
-  virtual void internalExecuteReaderData();
-  virtual void internalExecuteReducer();
+  virtual void internalExecuteReaderInformation(
+      vvStatistics::Clock::time_point submitted);
+  virtual void internalExecuteReaderData(
+      vvCancellationToken token, vvStatistics::Clock::time_point submitted,
+      std::shared_ptr<Stream> stream);
+  virtual void internalExecuteReducer(
+      vvCancellationToken token, vvStatistics::Clock::time_point submitted,
+      CacheMode mode);
   virtual bool invalidateReducedData();
   /** @} */
+
+  /**
+   * Collect finished background executions. Called from the GUI thread by
+   * vvCompletionQueue::drain(). @{
+   */
+  void completeInformation(const vvApplicationState &appState);
+  void completeRead(const vvApplicationState &appState);
+  void completeReduction(const vvApplicationState &appState, CacheMode mode);
+  /** @} */
+
+  std::future<void> m_informationFuture;
+  InformationCallback m_informationCallback;
+
+  // Streaming reduction of the running read, if any. Only changed by the GUI
+  // thread while no read is running, see pushChunk():
+  std::shared_ptr<Stream> m_stream;
+  const Stream *m_snapshotStream; // Stream matching the data. GUI thread only.
+  bool m_readStreamed; // Whether the running read is reduced by m_stream.
+
+  // Reduction pyramid, finest level first:
+  std::vector<double> m_reductionRatios;
+  std::vector<vtkSmartPointer<vtkDataObject> > m_pyramid;
+  bool m_pyramidDirty; // Levels must be recomputed for the current data.
+  unsigned long m_pyramidGeneration; // Incremented by invalidatePyramid().
+  std::future<void> m_pyramidFuture;
+  vvCancellationToken m_pyramidToken;
+  vvProgressCookie *m_pyramidCookie;
+
+  // Disk cache of the reduced data:
+  vvDiskCache *m_diskCache; // Set by update().
+  std::string m_reductionCacheKey; // Key of the running reduction, if cached.
+  std::string m_missedCacheKey; // Last key a Load reduction did not find.
+  vtkSmartPointer<vtkDataObject> m_cachedReduction; // Loaded by the task.
+  bool m_reductionCached; // m_reducedData was loaded for the current data...
+  std::string m_cachedParameters; // ...with these reductionCacheKey()s.
+  std::list<std::future<void> > m_cacheStores; // GUI thread only.
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,187 @@
+#include "vvStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// Nearest-rank percentile of sorted values:
+double percentile(const std::vector<double> &sorted, double p)
+{
+  if (sorted.empty())
+    {
+    return 0.;
+    }
+  std::size_t rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+vvStatistics::vvStatistics(std::size_t maxSamples)
+  : m_maxSamples(std::max<std::size_t>(maxSamples, 1))
+{
+}
+
+//------------------------------------------------------------------------------
+vvStatistics::~vvStatistics()
+{
+}
+
+//------------------------------------------------------------------------------
+std::string vvStatistics::uniquePrefix(const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::string result = name;
+  for (int i = 2; !m_prefixes.insert(result).second; ++i)
+    {
+    std::ostringstream str;
+    str << name << " (" << i << ")";
+    result = str.str();
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void vvStatistics::record(const std::string &series, double value)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  Series &s = m_series[series];
+  ++s.count;
+  s.sum += value;
+  s.last = value;
+  s.max = s.count == 1 ? value : std::max(s.max, value);
+
+  if (s.samples.size() < m_maxSamples)
+    {
+    s.samples.push_back(value);
+    }
+  else
+    {
+    s.samples[s.next] = value;
+    s.next = (s.next + 1) % m_maxSamples;
+    }
+}
+
+//------------------------------------------------------------------------------
+vvStatistics::Summary vvStatistics::summary(const std::string &series) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_series.find(series);
+  return it != m_series.end() ? summarize(it->second) : Summary();
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::size_t>
+vvStatistics::histogram(const std::string &series,
+                        const std::vector<double> &upperBounds) const
+{
+  std::vector<std::size_t> result(upperBounds.size() + 1, 0);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_series.find(series);
+  if (it != m_series.end())
+    {
+    for (double value : it->second.samples)
+      {
+      auto bucket = std::lower_bound(upperBounds.begin(), upperBounds.end(),
+                                     value);
+      ++result[bucket - upperBounds.begin()];
+      }
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::string>
+vvStatistics::seriesNames(const std::string &prefix) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::vector<std::string> result;
+  for (auto it = m_series.lower_bound(prefix);
+       it != m_series.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+       ++it)
+    {
+    result.push_back(it->first);
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void vvStatistics::dump(std::ostream &out, const std::string &prefix) const
+{
+  // Format into a buffer to avoid interleaving with other output:
+  std::ostringstream str;
+  str << std::left << std::setw(40) << "Series" << std::right
+      << std::setw(8) << "Count"
+      << std::setw(10) << "Last"
+      << std::setw(10) << "Mean"
+      << std::setw(10) << "P50"
+      << std::setw(10) << "P95"
+      << std::setw(10) << "P99"
+      << std::setw(10) << "Max" << "\n";
+
+  for (const std::string &name : this->seriesNames(prefix))
+    {
+    const Summary s = this->summary(name);
+    str << std::left << std::setw(40) << name << std::right
+        << std::setw(8) << s.count
+        << std::setw(10) << s.last
+        << std::setw(10) << s.mean
+        << std::setw(10) << s.p50
+        << std::setw(10) << s.p95
+        << std::setw(10) << s.p99
+        << std::setw(10) << s.max << "\n";
+    }
+
+  out << str.str();
+}
+
+//------------------------------------------------------------------------------
+void vvStatistics::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_series.clear();
+}
+
+//------------------------------------------------------------------------------
+void vvStatistics::Estimator::record(double seconds, double inputSize)
+{
+  // Weight of the latest execution in the moving average:
+  const double alpha = 0.3;
+
+  const double perUnit = seconds / std::max(inputSize, 1e-12);
+  m_secondsPerUnit = m_secondsPerUnit < 0. ?
+        perUnit : (1. - alpha) * m_secondsPerUnit + alpha * perUnit;
+}
+
+//------------------------------------------------------------------------------
+double vvStatistics::Estimator::estimate(double inputSize) const
+{
+  return m_secondsPerUnit < 0. ? -1. : m_secondsPerUnit * inputSize;
+}
+
+//------------------------------------------------------------------------------
+vvStatistics::Summary vvStatistics::summarize(const Series &series)
+{
+  Summary result;
+  result.count = series.count;
+  result.last = series.last;
+  result.max = series.max;
+  result.mean = series.count > 0 ? series.sum / series.count : 0.;
+
+  std::vector<double> sorted(series.samples);
+  std::sort(sorted.begin(), sorted.end());
+  result.p50 = percentile(sorted, 0.50);
+  result.p95 = percentile(sorted, 0.95);
+  result.p99 = percentile(sorted, 0.99);
+
+  return result;
+}
@@ -0,0 +1,142 @@
+#ifndef VVSTATISTICS_H
+#define VVSTATISTICS_H
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The vvStatistics class collects named timing series.
+ *
+ * Each series is identified by a name such as "Isosurface/HiRes/execute" and
+ * records durations in seconds. vvApplicationState owns the instance used by
+ * vtkVRUI, which records the following series for every vvLODAsyncGLObject and
+ * vvReader:
+ *
+ * - "<object>/<LOD>/queueWait": Time between submission to the vvThreadPool
+ *   and the start of execution.
+ * - "<object>/<LOD>/execute": Time spent executing the pipeline.
+ * - "<object>/<LOD>/exportResult": Time spent exporting the result on the GUI
+ *   thread.
+ * - "<object>/<LOD>/timeToVisible": Time from the first needsUpdate() that
+ *   flagged a change until the matching result is first rendered.
+ *
+ * All methods are thread-safe.
+ */
+class vvStatistics
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Predicts execution times from an exponential moving average of previous
+   * execution times per unit of input size (e.g. number of cells). Used for
+   * the progress estimates of vvAsyncGLObject and vvLODAsyncGLObject. Unlike
+   * vvStatistics, this is not thread-safe.
+   */
+  class Estimator
+  {
+  public:
+    /** Fold an execution of @a seconds on @a inputSize units into it. */
+    void record(double seconds, double inputSize = 1.);
+
+    /**
+     * Predicted seconds for @a inputSize units, or a negative value if
+     * nothing has been recorded.
+     */
+    double estimate(double inputSize = 1.) const;
+
+  private:
+    double m_secondsPerUnit{-1.};
+  };
+
+  /**
+   * Summary of a single series. count, mean, and max cover every recorded
+   * value; the percentiles are computed over the most recent maxSamples()
+   * values.
+   */
+  struct Summary
+  {
+    std::size_t count{0};
+    double last{0.};
+    double mean{0.};
+    double p50{0.};
+    double p95{0.};
+    double p99{0.};
+    double max{0.};
+  };
+
+  explicit vvStatistics(std::size_t maxSamples = 1024);
+  ~vvStatistics();
+
+  /** Seconds elapsed since @a start. */
+  static double elapsed(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  /**
+   * Return @a name, or @a name with a numeric suffix if it has already been
+   * returned by a previous call. Used to give each object its own series.
+   */
+  std::string uniquePrefix(const std::string &name);
+
+  /** Append @a value to @a series, creating it if needed. */
+  void record(const std::string &series, double value);
+
+  /** Summary of @a series. All fields are zero if it does not exist. */
+  Summary summary(const std::string &series) const;
+
+  /**
+   * Count the recent values (see maxSamples()) of @a series that fall into
+   * each bucket. Bucket i counts values <= @a upperBounds[i] (which must be
+   * ascending) that are not counted by a previous bucket; the last element of
+   * the result counts values above all bounds. The result always has
+   * upperBounds.size() + 1 elements.
+   */
+  std::vector<std::size_t> histogram(const std::string &series,
+                                     const std::vector<double> &upperBounds)
+  const;
+
+  /** Names of all series starting with @a prefix, in sorted order. */
+  std::vector<std::string>
+  seriesNames(const std::string &prefix = std::string()) const;
+
+  /** Write a table of all series starting with @a prefix to @a out. */
+  void dump(std::ostream &out, const std::string &prefix = std::string()) const;
+
+  /** Remove all recorded values. Prefixes remain reserved. */
+  void clear();
+
+  /** Number of recent values kept per series for percentiles. */
+  std::size_t maxSamples() const { return m_maxSamples; }
+
+private:
+  // Not implemented:
+  vvStatistics(const vvStatistics&);
+  vvStatistics& operator=(const vvStatistics&);
+
+  struct Series
+  {
+    std::size_t count{0};
+    double sum{0.};
+    double last{0.};
+    double max{0.};
+    std::vector<double> samples; // Ring buffer of recent values
+    std::size_t next{0};
+  };
+
+  static Summary summarize(const Series &series);
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, Series> m_series;
+  std::set<std::string> m_prefixes;
+  const std::size_t m_maxSamples;
+};
+
+#endif // VVSTATISTICS_H
@@ -0,0 +1,191 @@
+#include "vvThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+std::size_t resolveThreadCount(std::size_t requested)
+{
+  if (requested == 0)
+    {
+    // hardware_concurrency() may return 0 if the value is not computable:
+    requested = std::max(1u, std::thread::hardware_concurrency());
+    }
+  return requested;
+}
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+vvThreadPool::vvThreadPool(std::size_t numberOfThreads)
+  : m_sequence(0),
+    m_stopping(false)
+{
+  this->start(resolveThreadCount(numberOfThreads));
+}
+
+//------------------------------------------------------------------------------
+vvThreadPool::~vvThreadPool()
+{
+  this->stop();
+
+  // Discarding the tasks breaks their promises, releasing any waiters:
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_queue.clear();
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvThreadPool::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_workers.size();
+}
+
+//------------------------------------------------------------------------------
+void vvThreadPool::resize(std::size_t numberOfThreads)
+{
+  numberOfThreads = resolveThreadCount(numberOfThreads);
+  if (numberOfThreads == this->size())
+    {
+    return;
+    }
+
+  this->stop();
+  this->start(numberOfThreads);
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvThreadPool::queueDepth() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_queue.size();
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvThreadPool::tierCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tiers.size();
+}
+
+//------------------------------------------------------------------------------
+vvThreadPool::TierStatistics
+vvThreadPool::tierStatistics(unsigned int tier) const
+{
+  TierStatistics result;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (tier < m_tiers.size())
+    {
+    const TierState &state = m_tiers[tier];
+    result.queueDepth = state.queued;
+    result.started = state.started;
+    result.lastWait = state.lastWait;
+    result.meanWait = state.started > 0 ? state.totalWait / state.started : 0.;
+    result.maxWait = state.maxWait;
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+bool vvThreadPool::runsAfter(const Entry &a, const Entry &b)
+{
+  if (a.priority.tier != b.priority.tier)
+    {
+    return a.priority.tier > b.priority.tier;
+    }
+  if (a.priority.objectPriority != b.priority.objectPriority)
+    {
+    return a.priority.objectPriority < b.priority.objectPriority;
+    }
+  if (a.priority.relevance != b.priority.relevance)
+    {
+    return a.priority.relevance < b.priority.relevance;
+    }
+  return a.sequence > b.sequence;
+}
+
+//------------------------------------------------------------------------------
+void vvThreadPool::enqueue(const Priority &priority, Task task)
+{
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (priority.tier >= m_tiers.size())
+    {
+    m_tiers.resize(priority.tier + 1);
+    }
+  ++m_tiers[priority.tier].queued;
+
+  Entry entry;
+  entry.priority = priority;
+  entry.sequence = m_sequence++;
+  entry.queued = Clock::now();
+  entry.task = std::move(task);
+  m_queue.push_back(std::move(entry));
+  std::push_heap(m_queue.begin(), m_queue.end(), &vvThreadPool::runsAfter);
+  }
+  m_condition.notify_one();
+}
+
+//------------------------------------------------------------------------------
+void vvThreadPool::start(std::size_t numberOfThreads)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stopping = false;
+  m_workers.reserve(numberOfThreads);
+  for (std::size_t i = 0; i < numberOfThreads; ++i)
+    {
+    m_workers.emplace_back(&vvThreadPool::workerLoop, this);
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvThreadPool::stop()
+{
+  std::vector<std::thread> workers;
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stopping = true;
+  workers.swap(m_workers);
+  }
+  m_condition.notify_all();
+
+  for (auto &worker : workers)
+    {
+    worker.join();
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvThreadPool::workerLoop()
+{
+  for (;;)
+    {
+    Task task;
+
+    {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+    if (m_stopping)
+      {
+      return;
+      }
+
+    std::pop_heap(m_queue.begin(), m_queue.end(), &vvThreadPool::runsAfter);
+    Entry &entry = m_queue.back();
+
+    const double wait = std::chrono::duration<double>(
+          Clock::now() - entry.queued).count();
+    TierState &tier = m_tiers[entry.priority.tier];
+    --tier.queued;
+    ++tier.started;
+    tier.lastWait = wait;
+    tier.totalWait += wait;
+    tier.maxWait = std::max(tier.maxWait, wait);
+
+    task = std::move(entry.task);
+    m_queue.pop_back();
+    }
+
+    task();
+    }
+}
@@ -0,0 +1,175 @@
+#ifndef VVTHREADPOOL_H
+#define VVTHREADPOOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief The vvThreadPool class executes background work on a fixed set of
+ * worker threads.
+ *
+ * All asynchronous pipeline executions in vtkVRUI (vvAsyncGLObject,
+ * vvLODAsyncGLObject and vvReader) are submitted to the pool owned by
+ * vvApplicationState. This bounds the number of concurrent executions and
+ * avoids starting a new thread for every update.
+ *
+ * Pending tasks are ordered by their Priority: lower tiers run first, then
+ * higher object priorities, then higher relevance, then submission order. For
+ * instance, vvLODAsyncGLObject submits its fastest LOD at tier 0, so every
+ * object gets something on screen before any object's best LOD is computed.
+ * Queue depth and wait times are tracked per tier (see tierStatistics()).
+ *
+ * submit() returns a std::future that becomes ready once the task has run (or
+ * has been discarded during pool destruction, in which case get() throws
+ * std::future_error). Unlike futures returned by std::async, these futures do
+ * not block in their destructors, so owners must wait() on them explicitly
+ * before destroying any state the task uses.
+ */
+class vvThreadPool
+{
+public:
+  /**
+   * Scheduling order of a task. See class documentation.
+   */
+  struct Priority
+  {
+    explicit Priority(unsigned int tier_ = 0, int objectPriority_ = 0,
+                      double relevance_ = 0.)
+      : tier(tier_), objectPriority(objectPriority_), relevance(relevance_)
+    {}
+
+    /** Priority class. Tasks in lower tiers always run first. */
+    unsigned int tier;
+    /** Higher values run first within a tier. */
+    int objectPriority;
+    /** Higher values run first among tasks with equal objectPriority. */
+    double relevance;
+  };
+
+  /**
+   * Scheduling statistics for a single tier. Times are in seconds.
+   */
+  struct TierStatistics
+  {
+    /** Number of tasks currently waiting. */
+    std::size_t queueDepth{0};
+    /** Number of tasks that have been started. */
+    std::size_t started{0};
+    /** Wait time of the most recently started task. */
+    double lastWait{0.};
+    /** Average wait time of all started tasks. */
+    double meanWait{0.};
+    /** Longest wait time of any started task. */
+    double maxWait{0.};
+  };
+
+  /**
+   * Create a pool with @a numberOfThreads workers. If zero, the number of
+   * hardware threads is used.
+   */
+  explicit vvThreadPool(std::size_t numberOfThreads = 0);
+
+  /**
+   * Waits for running tasks to finish. Queued tasks that have not started are
+   * discarded.
+   */
+  ~vvThreadPool();
+
+  /**
+   * The number of worker threads. Setting this waits for the running tasks to
+   * complete before the workers are restarted; queued tasks are preserved.
+   * A value of zero selects the number of hardware threads.
+   * @{
+   */
+  std::size_t size() const;
+  void resize(std::size_t numberOfThreads);
+  /** @} */
+
+  /**
+   * The number of tasks waiting for a worker thread.
+   */
+  std::size_t queueDepth() const;
+
+  /**
+   * One more than the highest tier submitted so far.
+   */
+  std::size_t tierCount() const;
+
+  /**
+   * Scheduling statistics for @a tier.
+   */
+  TierStatistics tierStatistics(unsigned int tier) const;
+
+  /**
+   * Queue @a func to be called with @a args on a worker thread, ordered by
+   * @a priority.
+   */
+  template <typename Callable, typename... Args>
+  std::future<typename std::result_of<Callable(Args...)>::type>
+  submit(const Priority &priority, Callable &&func, Args&&... args);
+
+private:
+  // Not implemented:
+  vvThreadPool(const vvThreadPool&);
+  vvThreadPool& operator=(const vvThreadPool&);
+
+  using Clock = std::chrono::steady_clock;
+  using Task = std::function<void()>;
+
+  struct Entry
+  {
+    Priority priority;
+    unsigned long long sequence;
+    Clock::time_point queued;
+    Task task;
+  };
+
+  // Heap comparator -- returns true if a runs after b:
+  static bool runsAfter(const Entry &a, const Entry &b);
+
+  struct TierState
+  {
+    std::size_t queued{0};
+    std::size_t started{0};
+    double lastWait{0.};
+    double totalWait{0.};
+    double maxWait{0.};
+  };
+
+  void enqueue(const Priority &priority, Task task);
+  void start(std::size_t numberOfThreads);
+  void stop();
+  void workerLoop();
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::vector<Entry> m_queue; // heap ordered by runsAfter.
+  std::vector<TierState> m_tiers;
+  std::vector<std::thread> m_workers;
+  unsigned long long m_sequence;
+  bool m_stopping;
+};
+
+//------------------------------------------------------------------------------
+template <typename Callable, typename... Args>
+std::future<typename std::result_of<Callable(Args...)>::type>
+vvThreadPool::submit(const Priority &priority, Callable &&func, Args&&... args)
+{
+  using Result = typename std::result_of<Callable(Args...)>::type;
+
+  // std::function requires copyable callables, so the packaged_task is shared:
+  auto task = std::make_shared<std::packaged_task<Result()> >(
+        std::bind(std::forward<Callable>(func), std::forward<Args>(args)...));
+  std::future<Result> result = task->get_future();
+  this->enqueue(priority, [task]() { (*task)(); });
+  return result;
+}
+
+#endif // VVTHREADPOOL_H
@@ -0,0 +1,369 @@
+#include "vvTimeSeriesReader.h"
+
+#include <vtkDataObject.h>
+
+#include "vvThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const std::size_t NoStep = static_cast<std::size_t>(-1);
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+vvTimeSeriesReader::vvTimeSeriesReader()
+  : m_timeStep(0),
+    m_dataStep(NoStep),
+    m_pendingStep(0),
+    m_readStep(NoStep),
+    m_readPending(false),
+    m_cacheGeneration(0),
+    m_pendingGeneration(0),
+    m_prefetchCount(4),
+    m_cacheSize(8),
+    m_prefetchOrigin(0),
+    m_prefetchWindow(0),
+    m_prefetchNumSteps(0),
+    m_direction(1),
+    m_useCounter(0)
+{
+}
+
+//------------------------------------------------------------------------------
+vvTimeSeriesReader::~vvTimeSeriesReader()
+{
+  // readTimeStep() is implemented by the subclass, so all reads must finish
+  // before the vvReader destructor:
+  m_token.cancel();
+  m_prefetchToken.cancel();
+  if (m_future.valid())
+    {
+    m_future.wait();
+    }
+  for (auto &prefetch : m_prefetches)
+    {
+    prefetch.wait();
+    }
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvTimeSeriesReader::timeStepForValue(double time) const
+{
+  std::size_t result = 0;
+  for (std::size_t i = 1; i < m_timeStepValues.size(); ++i)
+    {
+    if (std::fabs(m_timeStepValues[i] - time) <
+        std::fabs(m_timeStepValues[result] - time))
+      {
+      result = i;
+      }
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void vvTimeSeriesReader::setTimeStep(std::size_t step)
+{
+  if (step != m_timeStep)
+    {
+    // The shorter way around, so that looping playback stays forward when it
+    // wraps from the last step to the first:
+    const std::size_t numSteps = this->numberOfTimeSteps();
+    if (numSteps > 1 && step < numSteps && m_timeStep < numSteps)
+      {
+      m_direction =
+          (step + numSteps - m_timeStep) % numSteps <= numSteps / 2 ? 1 : -1;
+      }
+    else
+      {
+      m_direction = step > m_timeStep ? 1 : -1;
+      }
+    m_timeStep = step;
+    }
+}
+
+//------------------------------------------------------------------------------
+void vvTimeSeriesReader::setCacheSize(std::size_t steps)
+{
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  m_cacheSize = steps;
+  this->trimCache(m_dataStep);
+}
+
+//------------------------------------------------------------------------------
+vvTimeSeriesReader::CacheStatistics vvTimeSeriesReader::cacheStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+
+  CacheStatistics result = m_cacheStatistics;
+  result.entries = 0;
+  for (const auto &entry : m_cache)
+    {
+    if (entry.second.state == EntryState::Ready)
+      {
+      ++result.entries;
+      }
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void vvTimeSeriesReader::clearCache()
+{
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  for (auto it = m_cache.begin(); it != m_cache.end();)
+    {
+    if (it->second.state == EntryState::Loading)
+      { // Dropped by the reading thread once it finishes:
+      it->second.stale = true;
+      ++it;
+      }
+    else
+      {
+      it = m_cache.erase(it);
+      }
+    }
+  m_dataStep = NoStep;
+  ++m_cacheGeneration; // A running read must not set m_dataStep.
+}
+
+//------------------------------------------------------------------------------
+bool vvTimeSeriesReader::dataNeedsUpdate()
+{
+  // vvReader only calls this once the previous read has been collected:
+  if (m_readPending)
+    {
+    m_readPending = false;
+    if (m_pendingGeneration == m_cacheGeneration)
+      {
+      m_dataStep = m_readStep;
+      }
+    }
+
+  if (m_timeStep == m_dataStep)
+    {
+    return false;
+    }
+
+  // A read is about to be launched:
+  m_pendingStep = m_timeStep;
+  m_readStep = NoStep;
+  m_readPending = true;
+  m_pendingGeneration = m_cacheGeneration;
+  this->schedulePrefetch();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vvTimeSeriesReader::executeReaderData(const vvCancellationToken &token)
+{
+  const std::size_t step = m_pendingStep;
+  m_timeStepData = this->fetchTimeStep(step, token, /*prefetch =*/ false);
+  m_readStep = token.cancelled() ? NoStep : step;
+}
+
+//------------------------------------------------------------------------------
+void vvTimeSeriesReader::schedulePrefetch()
+{
+  // Forget finished prefetches:
+  m_prefetches.remove_if([](const std::future<void> &prefetch)
+    {
+    return prefetch.wait_for(std::chrono::seconds(0)) ==
+        std::future_status::ready;
+    });
+
+  // Leave room in the cache for the current step:
+  const std::size_t numSteps = this->numberOfTimeSteps();
+  std::size_t count = 0;
+  if (numSteps > 1 && m_cacheSize > 1)
+    {
+    count = std::min(m_prefetchCount, std::min(m_cacheSize, numSteps) - 1);
+    }
+  m_prefetchOrigin = m_pendingStep;
+  m_prefetchWindow = count;
+  m_prefetchNumSteps = numSteps;
+  if (count == 0 || m_threadPool == nullptr)
+    {
+    return;
+    }
+
+  const int direction = m_direction;
+  for (std::size_t i = 1; i <= count; ++i)
+    {
+    const std::size_t step = direction > 0 ?
+          (m_pendingStep + i) % numSteps :
+          (m_pendingStep + numSteps - i % numSteps) % numSteps;
+
+    {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    if (m_cache.find(step) != m_cache.end())
+      {
+      continue;
+      }
+    m_cache[step].state = EntryState::Queued;
+    ++m_cacheStatistics.prefetches;
+    }
+
+    // Nearer steps are more relevant:
+    m_prefetches.push_back(m_threadPool->submit(
+          vvThreadPool::Priority(PrefetchTier, 0, -static_cast<double>(i)),
+          &vvTimeSeriesReader::prefetchTimeStep, this, step));
+    }
+}
+
+//------------------------------------------------------------------------------
+bool vvTimeSeriesReader::inPrefetchWindow(std::size_t step) const
+{
+  const std::size_t numSteps = m_prefetchNumSteps;
+  if (numSteps == 0)
+    {
+    return false;
+    }
+
+  const std::size_t origin = m_prefetchOrigin;
+  const std::size_t distance = m_direction > 0 ?
+        (step + numSteps - origin) % numSteps :
+        (origin + numSteps - step) % numSteps;
+  return distance > 0 && distance <= m_prefetchWindow;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject>
+vvTimeSeriesReader::fetchTimeStep(std::size_t step,
+                                  const vvCancellationToken &token,
+                                  bool prefetch)
+{
+  std::unique_lock<std::mutex> lock(m_cacheMutex);
+
+  if (prefetch)
+    {
+    // The entry is gone if the cache was cleared, and already Loading if a
+    // demand read claimed it:
+    auto it = m_cache.find(step);
+    if (it == m_cache.end() || it->second.state != EntryState::Queued)
+      {
+      return vtkSmartPointer<vtkDataObject>();
+      }
+    if (token.cancelled() || !this->inPrefetchWindow(step))
+      {
+      m_cache.erase(it);
+      return vtkSmartPointer<vtkDataObject>();
+      }
+    it->second.state = EntryState::Loading;
+    }
+  else
+    {
+    bool counted = false;
+    for (;;)
+      {
+      auto it = m_cache.find(step);
+      if (it == m_cache.end())
+        {
+        m_cacheStatistics.misses += counted ? 0 : 1;
+        m_cache[step].state = EntryState::Loading;
+        break;
+        }
+
+      CacheEntry &entry = it->second;
+      if (entry.state == EntryState::Ready)
+        {
+        m_cacheStatistics.hits += counted ? 0 : 1;
+        entry.lastUse = ++m_useCounter;
+        return entry.data;
+        }
+      if (entry.state == EntryState::Queued)
+        { // Prefetch has not started yet; read it here instead:
+        m_cacheStatistics.misses += counted ? 0 : 1;
+        entry.state = EntryState::Loading;
+        break;
+        }
+
+      // Being read by a prefetch -- wait for it. If it fails or is stale,
+      // the entry is removed and the step is read here:
+      if (!counted && !entry.stale)
+        {
+        ++m_cacheStatistics.hits;
+        counted = true;
+        }
+      m_cacheCondition.wait(lock);
+      }
+    }
+
+  // Read without holding the lock:
+  lock.unlock();
+  vtkSmartPointer<vtkDataObject> data;
+  bool failed = true;
+  try
+    {
+    const vvStatistics::Clock::time_point start = vvStatistics::Clock::now();
+    data = this->readTimeStep(step, token);
+    m_statistics->record(m_statisticsPrefix + "/TimeStep/read",
+                         vvStatistics::elapsed(start));
+    failed = false;
+    }
+  catch (...)
+    {
+    if (!prefetch)
+      {
+      lock.lock();
+      m_cache.erase(step);
+      m_cacheCondition.notify_all();
+      throw;
+      }
+    }
+  lock.lock();
+
+  auto it = m_cache.find(step);
+  if (failed || token.cancelled() || it->second.stale)
+    {
+    m_cache.erase(it);
+    }
+  else
+    {
+    it->second.state = EntryState::Ready;
+    it->second.data = data;
+    it->second.lastUse = ++m_useCounter;
+    this->trimCache(step);
+    }
+  m_cacheCondition.notify_all();
+
+  return data;
+}
+
+//------------------------------------------------------------------------------
+void vvTimeSeriesReader::prefetchTimeStep(std::size_t step)
+{
+  this->fetchTimeStep(step, m_prefetchToken, /*prefetch =*/ true);
+}
+
+//------------------------------------------------------------------------------
+void vvTimeSeriesReader::trimCache(std::size_t keep)
+{
+  std::size_t ready = 0;
+  for (const auto &entry : m_cache)
+    {
+    ready += entry.second.state == EntryState::Ready ? 1 : 0;
+    }
+
+  while (ready > std::max<std::size_t>(m_cacheSize, 1))
+    {
+    auto victim = m_cache.end();
+    for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+      {
+      if (it->first != keep && it->second.state == EntryState::Ready &&
+          (victim == m_cache.end() ||
+           it->second.lastUse < victim->second.lastUse))
+        {
+        victim = it;
+        }
+      }
+    if (victim == m_cache.end())
+      {
+      break;
+      }
+    m_cache.erase(victim);
+    ++m_cacheStatistics.evictions;
+    --ready;
+    }
+}
@@ -0,0 +1,208 @@
+#ifndef VVTIMESERIESREADER_H
+#define VVTIMESERIESREADER_H
+
+#include "vvReader.h"
+
+#include <vtkSmartPointer.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+class vtkDataObject;
+
+/**
+ * @brief The vvTimeSeriesReader class is a vvReader for data with multiple
+ * timesteps.
+ *
+ * Subclasses implement readTimeStep() to decode a single timestep, and fill
+ * m_timeStepValues from updateInformationCache(). Setting timeStep() triggers
+ * a read of that step on the next update(), which is served from a bounded
+ * cache of decoded timesteps when possible. Whenever a new step is requested,
+ * the next prefetchCount() steps in the playback direction (inferred from the
+ * last change of timeStep(), wrapping around at the ends) are read in the
+ * background at a low vvThreadPool priority, so that animations do not stall
+ * on every step.
+ *
+ * The read step is passed to updateDataCache() in m_timeStepData. The
+ * duration of every readTimeStep() call is recorded as
+ * "<prefix>/TimeStep/read" in vvApplicationState::statistics().
+ */
+class vvTimeSeriesReader : public vvReader
+{
+public:
+  /**
+   * Tier of prefetch tasks in the vvThreadPool, after the levels of detail of
+   * vvLODAsyncGLObject and regular reads.
+   */
+  static const unsigned int PrefetchTier = 8;
+
+  /**
+   * Timestep cache statistics. The hit rate is hits / (hits + misses).
+   */
+  struct CacheStatistics
+  {
+    /** Requested steps that were cached or already being prefetched. */
+    std::size_t hits{0};
+    /** Requested steps that had to be read on demand. */
+    std::size_t misses{0};
+    /** Prefetch tasks submitted. */
+    std::size_t prefetches{0};
+    /** Decoded steps dropped to keep the cache within cacheSize(). */
+    std::size_t evictions{0};
+    /** Decoded steps currently in the cache. */
+    std::size_t entries{0};
+  };
+
+  vvTimeSeriesReader();
+  ~vvTimeSeriesReader();
+
+  /**
+   * The number of timesteps, as reported by updateInformation() or
+   * updateInformationAsync().
+   */
+  std::size_t numberOfTimeSteps() const { return m_timeStepValues.size(); }
+
+  /** The time values of all timesteps, in order. */
+  const std::vector<double>& timeStepValues() const
+  { return m_timeStepValues; }
+
+  /** The index of the timestep closest to @a time. 0 if there are none. */
+  std::size_t timeStepForValue(double time) const;
+
+  /**
+   * The timestep to read. Changing it also sets the playback direction used
+   * for prefetching: forward if @a step is at most half of the timesteps ahead
+   * of the previous one, wrapping around at the end, and backward otherwise.
+   * @{
+   */
+  std::size_t timeStep() const { return m_timeStep; }
+  void setTimeStep(std::size_t step);
+  /** @} */
+
+  /**
+   * The number of upcoming timesteps to prefetch. Limited to cacheSize() - 1.
+   * Default is 4; 0 disables prefetching.
+   * @{
+   */
+  std::size_t prefetchCount() const { return m_prefetchCount; }
+  void setPrefetchCount(std::size_t count) { m_prefetchCount = count; }
+  /** @} */
+
+  /**
+   * The maximum number of decoded timesteps kept, least recently used
+   * first out. Default is 8.
+   * @{
+   */
+  std::size_t cacheSize() const { return m_cacheSize; }
+  void setCacheSize(std::size_t steps);
+  /** @} */
+
+  /** Timestep cache statistics. */
+  CacheStatistics cacheStatistics() const;
+
+protected:
+  /**
+   * Drop all cached timesteps and read the current one again on the next
+   * update(). Call from the GUI thread when a reader parameter that affects
+   * the decoded data changes.
+   */
+  void clearCache();
+
+  /** Time values of all steps. Set by the subclass's updateInformationCache. */
+  std::vector<double> m_timeStepValues;
+
+  /** The step read by the last update, for updateDataCache(). */
+  vtkSmartPointer<vtkDataObject> m_timeStepData;
+
+private: // Virtual API:
+  /**
+   * Read and decode timestep @a step. This is called from background threads,
+   * possibly for several steps at once, so implementations must not share VTK
+   * readers between calls. If @a token is cancelled, the read should stop as
+   * soon as possible.
+   */
+  virtual vtkSmartPointer<vtkDataObject>
+  readTimeStep(std::size_t step, const vvCancellationToken &token) = 0;
+
+private: // vvReader virtual API:
+  bool dataNeedsUpdate() final;
+  void executeReaderData(const vvCancellationToken &token) final;
+
+private: // Internal methods:
+  enum class EntryState
+  {
+    Queued,  // Prefetch submitted, but not started.
+    Loading, // readTimeStep() in progress.
+    Ready
+  };
+
+  struct CacheEntry
+  {
+    EntryState state{EntryState::Queued};
+    bool stale{false}; // Set by clearCache() while loading.
+    vtkSmartPointer<vtkDataObject> data;
+    unsigned long long lastUse{0};
+  };
+
+  /**
+   * Submit prefetch tasks for the steps following m_pendingStep. GUI thread
+   * only.
+   */
+  void schedulePrefetch();
+
+  /**
+   * Return true if @a step is one of the steps currently being prefetched.
+   */
+  bool inPrefetchWindow(std::size_t step) const;
+
+  /**
+   * Read @a step through the cache. Returns nullptr if a prefetch finds that
+   * its step is no longer needed. Demand reads rethrow exceptions from
+   * readTimeStep(); prefetches discard them.
+   */
+  vtkSmartPointer<vtkDataObject> fetchTimeStep(std::size_t step,
+                                               const vvCancellationToken &token,
+                                               bool prefetch);
+
+  /** Body of a prefetch task. */
+  void prefetchTimeStep(std::size_t step);
+
+  /** Drop least recently used entries beyond cacheSize(). m_cacheMutex. */
+  void trimCache(std::size_t keep);
+
+  std::size_t m_timeStep;
+  std::size_t m_dataStep;    // Step of m_timeStepData, or -1. GUI thread only.
+  std::size_t m_pendingStep; // Step read by the running update.
+  std::size_t m_readStep;    // Written by the read: m_pendingStep, or -1.
+
+  // m_readStep is published to m_dataStep by the next dataNeedsUpdate(), after
+  // the read has been collected, unless clearCache() ran while it was running:
+  bool m_readPending;
+  unsigned long m_cacheGeneration; // Incremented by clearCache().
+  unsigned long m_pendingGeneration; // m_cacheGeneration when launched.
+  std::size_t m_prefetchCount;
+  std::size_t m_cacheSize;
+
+  // Prefetch window, read by prefetch tasks to drop unneeded steps:
+  std::atomic<std::size_t> m_prefetchOrigin;
+  std::atomic<std::size_t> m_prefetchWindow;
+  std::atomic<std::size_t> m_prefetchNumSteps;
+  std::atomic<int> m_direction; // +1 forward, -1 backward.
+
+  mutable std::mutex m_cacheMutex;
+  std::condition_variable m_cacheCondition; // Signalled when loads finish.
+  std::map<std::size_t, CacheEntry> m_cache;
+  unsigned long long m_useCounter;
+  CacheStatistics m_cacheStatistics;
+
+  vvCancellationToken m_prefetchToken;
+  std::list<std::future<void> > m_prefetches; // GUI thread only.
+};
+
+#endif // VVTIMESERIESREADER_H
@@ -0,0 +1,188 @@
+#include "vvTracer.h"
+
+namespace {
+
+void writeJSONString(std::ostream &out, const char *str)
+{
+  out << '"';
+  for (; *str; ++str)
+    {
+    switch (*str)
+      {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(*str) >= 0x20)
+          {
+          out << *str;
+          }
+        break;
+      }
+    }
+  out << '"';
+}
+
+std::int64_t microseconds(vvTracer::Clock::duration d)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+// Buffered events are written to the file once there are this many:
+const std::size_t FlushThreshold = 16384;
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+std::atomic<bool> vvTracer::s_enabled(false);
+
+//------------------------------------------------------------------------------
+vvTracer &vvTracer::instance()
+{
+  static vvTracer tracer;
+  return tracer;
+}
+
+//------------------------------------------------------------------------------
+void vvTracer::start(const std::string &fileName)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::lock_guard<std::mutex> fileLock(m_fileMutex);
+  if (m_file.is_open())
+    { // Finish the previous trace:
+    this->writeEvents(m_events);
+    this->closeFile();
+    }
+
+  m_events.clear();
+  m_eventCount = 0;
+  m_epoch = Clock::now();
+
+  // A failed open is reported by stop():
+  m_file.clear();
+  m_file.open(fileName.c_str());
+  m_file << "{\"traceEvents\":[\n";
+  m_firstEvent = true;
+  s_enabled = true;
+}
+
+//------------------------------------------------------------------------------
+bool vvTracer::stop()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!s_enabled)
+    {
+    return true;
+    }
+  s_enabled = false;
+
+  std::vector<Event> events;
+  events.swap(m_events);
+
+  // Taken before releasing m_mutex, so that a batch being written by
+  // addSpan() finishes before the file is closed:
+  std::lock_guard<std::mutex> fileLock(m_fileMutex);
+  lock.unlock();
+
+  this->writeEvents(events);
+  return this->closeFile();
+}
+
+//------------------------------------------------------------------------------
+void vvTracer::addSpan(const char *name, const char *category,
+                       const std::string &detail, Clock::time_point start,
+                       Clock::time_point end)
+{
+  if (!enabled())
+    {
+    return;
+    }
+
+  const unsigned int thread = threadId();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!s_enabled) // Stopped while waiting for the lock
+    {
+    return;
+    }
+  Event event = { name, category, detail, microseconds(start - m_epoch),
+                  microseconds(end - start), thread };
+  m_events.push_back(std::move(event));
+  ++m_eventCount;
+
+  if (m_events.size() < FlushThreshold)
+    {
+    return;
+    }
+
+  // Write the batch without blocking other threads' spans:
+  std::vector<Event> events;
+  events.swap(m_events);
+  std::lock_guard<std::mutex> fileLock(m_fileMutex);
+  lock.unlock();
+  this->writeEvents(events);
+}
+
+//------------------------------------------------------------------------------
+std::size_t vvTracer::eventCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_eventCount;
+}
+
+//------------------------------------------------------------------------------
+void vvTracer::writeEvents(const std::vector<Event> &events)
+{
+  for (const Event &event : events)
+    {
+    m_file << (m_firstEvent ? "" : ",\n") << "{\"name\":";
+    m_firstEvent = false;
+    writeJSONString(m_file, event.name);
+    m_file << ",\"cat\":";
+    writeJSONString(m_file, event.category);
+    m_file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+           << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+    if (!event.detail.empty())
+      {
+      m_file << ",\"args\":{\"detail\":";
+      writeJSONString(m_file, event.detail.c_str());
+      m_file << "}";
+      }
+    m_file << "}";
+    }
+}
+
+//------------------------------------------------------------------------------
+bool vvTracer::closeFile()
+{
+  m_file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  m_file.close();
+  return static_cast<bool>(m_file);
+}
+
+//------------------------------------------------------------------------------
+vvTracer::vvTracer()
+  : m_eventCount(0),
+    m_firstEvent(true)
+{
+}
+
+//------------------------------------------------------------------------------
+vvTracer::~vvTracer()
+{
+  this->stop();
+}
+
+//------------------------------------------------------------------------------
+unsigned int vvTracer::threadId()
+{
+  static std::atomic<unsigned int> nextId(1);
+  static thread_local unsigned int id = nextId++;
+  return id;
+}
@@ -0,0 +1,185 @@
+#ifndef VVTRACER_H
+#define VVTRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The vvTracer class records timed spans in the Chrome trace-event
+ * format.
+ *
+ * Tracing is off by default. Once start() is called, every Span records a
+ * "complete" event with its thread id. Events are buffered and written to the
+ * file passed to start() in batches, so memory use stays bounded however long
+ * tracing runs; stop() writes the rest and closes the file. The file can be
+ * loaded in chrome://tracing or https://ui.perfetto.dev to see how background
+ * pipeline executions overlap with frame() and display().
+ *
+ * A disabled Span costs a single relaxed atomic load (its constructor and
+ * destructor are inline and do not touch instance()), so spans can be left in
+ * production code:
+ *
+ * @code
+ * void MyPipeline::execute(const vvCancellationToken &token)
+ * {
+ *   vvTracer::Span span("MyPipeline::execute", "pipeline");
+ *   ...
+ * }
+ * @endcode
+ *
+ * vvApplicationState::setTraceFile() is the usual way to enable tracing.
+ */
+class vvTracer
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Records the lifetime of a scope. @a name and @a category must outlive the
+   * tracer (typically string literals). The optional @a detail is shown as an
+   * argument of the event; it is copied, and only if tracing is enabled.
+   */
+  class Span
+  {
+  public:
+    explicit Span(const char *name, const char *category = "vtkVRUI",
+                  const char *detail = nullptr);
+    Span(const char *name, const char *category, const std::string &detail);
+    ~Span();
+
+  private:
+    // Not implemented:
+    Span(const Span&);
+    Span& operator=(const Span&);
+
+    const char *m_name;
+    const char *m_category;
+    std::string m_detail;
+    Clock::time_point m_start;
+    bool m_enabled;
+  };
+
+  /** The process-wide tracer. */
+  static vvTracer& instance();
+
+  /** True between start() and stop(). Thread-safe. */
+  static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * Start recording to @a fileName, which is overwritten. If already started,
+   * the previous file is finished first.
+   */
+  void start(const std::string &fileName);
+
+  /**
+   * Stop recording, write the remaining events and close the file passed to
+   * start(). Returns false if the file could not be written. Does nothing if
+   * not started.
+   */
+  bool stop();
+
+  /**
+   * Record a span from @a start to @a end on the current thread. Usually
+   * called by Span. Does nothing while disabled.
+   */
+  void addSpan(const char *name, const char *category,
+               const std::string &detail, Clock::time_point start,
+               Clock::time_point end);
+
+  /** The number of events recorded since start(). */
+  std::size_t eventCount() const;
+
+private:
+  vvTracer();
+  ~vvTracer();
+
+  // Not implemented:
+  vvTracer(const vvTracer&);
+  vvTracer& operator=(const vvTracer&);
+
+  /** Small, stable id for the calling thread. */
+  static unsigned int threadId();
+
+  struct Event
+  {
+    const char *name;
+    const char *category;
+    std::string detail;
+    std::int64_t start; // Microseconds since start()
+    std::int64_t duration; // Microseconds
+    unsigned int thread;
+  };
+
+  /**
+   * Append @a events to m_file. The caller must hold m_fileMutex.
+   */
+  void writeEvents(const std::vector<Event> &events);
+
+  /**
+   * Close m_file, returning false if any write failed. The caller must hold
+   * m_fileMutex.
+   */
+  bool closeFile();
+
+  // Static, so checking it never runs instance()'s initialization guard:
+  static std::atomic<bool> s_enabled;
+
+  // Guards the event buffer. Taken before m_fileMutex:
+  mutable std::mutex m_mutex;
+  std::vector<Event> m_events;
+  std::size_t m_eventCount;
+  Clock::time_point m_epoch;
+
+  // Guards the output file:
+  std::mutex m_fileMutex;
+  std::ofstream m_file;
+  bool m_firstEvent;
+};
+
+//------------------------------------------------------------------------------
+inline vvTracer::Span::Span(const char *name, const char *category,
+                            const char *detail)
+  : m_name(name),
+    m_category(category),
+    m_enabled(vvTracer::enabled())
+{
+  if (m_enabled)
+    {
+    if (detail)
+      {
+      m_detail = detail;
+      }
+    m_start = Clock::now();
+    }
+}
+
+//------------------------------------------------------------------------------
+inline vvTracer::Span::Span(const char *name, const char *category,
+                            const std::string &detail)
+  : m_name(name),
+    m_category(category),
+    m_enabled(vvTracer::enabled())
+{
+  if (m_enabled)
+    {
+    m_detail = detail;
+    m_start = Clock::now();
+    }
+}
+
+//------------------------------------------------------------------------------
+inline vvTracer::Span::~Span()
+{
+  if (m_enabled)
+    {
+    vvTracer::instance().addSpan(m_name, m_category, m_detail, m_start,
+                                 Clock::now());
+    }
+}
+
+#endif // VVTRACER_H